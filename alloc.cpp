@@ -0,0 +1,113 @@
+#include "alloc.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef SNAKE_ALLOC_TRACK
+#include <SDL2/SDL.h>
+#endif
+
+using namespace std;
+
+static atomic<long long> allocations(0);
+
+#ifdef SNAKE_ALLOC_TRACK
+
+static atomic<long long> phaseCounts[ALLOC_PHASE_COUNT];
+static atomic<long long> phaseBytes[ALLOC_PHASE_COUNT];
+static thread_local AllocPhase currentPhase = ALLOC_OTHER;
+
+static SDL_malloc_func sdlMalloc;
+static SDL_calloc_func sdlCalloc;
+static SDL_realloc_func sdlRealloc;
+static SDL_free_func sdlFree;
+
+static void countAllocation(size_t size) {
+    phaseCounts[currentPhase].fetch_add(1, memory_order_relaxed);
+    phaseBytes[currentPhase].fetch_add(static_cast<long long>(size), memory_order_relaxed);
+}
+
+static void* SDLCALL trackedMalloc(size_t size) {
+    countAllocation(size);
+    return sdlMalloc(size);
+}
+
+static void* SDLCALL trackedCalloc(size_t count, size_t size) {
+    countAllocation(count * size);
+    return sdlCalloc(count, size);
+}
+
+static void* SDLCALL trackedRealloc(void* p, size_t size) {
+    countAllocation(size);
+    return sdlRealloc(p, size);
+}
+
+static void SDLCALL trackedFree(void* p) {
+    sdlFree(p);
+}
+
+// Must run before SDL allocates anything, i.e. before SDL_Init
+void allocTrackInstall() {
+    static bool installed = false;
+    if (installed) {
+        return;
+    }
+    installed = true;
+    SDL_GetMemoryFunctions(&sdlMalloc, &sdlCalloc, &sdlRealloc, &sdlFree);
+    SDL_SetMemoryFunctions(trackedMalloc, trackedCalloc, trackedRealloc, trackedFree);
+}
+
+AllocPhaseStats allocPhaseStats(AllocPhase phase) {
+    AllocPhaseStats stats = { phaseCounts[phase].load(), phaseBytes[phase].load() };
+    return stats;
+}
+
+void allocPhaseReset() {
+    for (int i = 0; i < ALLOC_PHASE_COUNT; ++i) {
+        phaseCounts[i] = 0;
+        phaseBytes[i] = 0;
+    }
+}
+
+const char* allocPhaseName(AllocPhase phase) {
+    switch (phase) {
+        case ALLOC_EVENTS: return "events";
+        case ALLOC_UPDATE: return "update";
+        case ALLOC_RENDER: return "render";
+        default:           return "other";
+    }
+}
+
+AllocPhaseScope::AllocPhaseScope(AllocPhase phase) : previous(currentPhase) {
+    currentPhase = phase;
+}
+
+AllocPhaseScope::~AllocPhaseScope() {
+    currentPhase = previous;
+}
+
+#endif
+
+long long allocationCount() {
+    return allocations.load(memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+#ifdef SNAKE_ALLOC_TRACK
+    countAllocation(size);
+#endif
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
@@ -0,0 +1,43 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+// Global operator new/delete are replaced to count allocations for the performance overlay.
+// Building with -DSNAKE_ALLOC_TRACK also hooks SDL_malloc and attributes every allocation
+// to the frame phase the allocating thread is in, so steady-state allocations can be caught.
+
+enum AllocPhase { ALLOC_OTHER, ALLOC_EVENTS, ALLOC_UPDATE, ALLOC_RENDER, ALLOC_PHASE_COUNT };
+
+struct AllocPhaseStats {
+    long long count;
+    long long bytes;
+};
+
+long long allocationCount();
+
+#ifdef SNAKE_ALLOC_TRACK
+
+void allocTrackInstall();
+AllocPhaseStats allocPhaseStats(AllocPhase phase);
+void allocPhaseReset();
+const char* allocPhaseName(AllocPhase phase);
+
+class AllocPhaseScope {
+public:
+    explicit AllocPhaseScope(AllocPhase phase);
+    ~AllocPhaseScope();
+
+private:
+    AllocPhase previous;
+};
+
+#define ALLOC_PHASE(phase) AllocPhaseScope allocPhaseScope(phase)
+
+#else
+
+inline void allocTrackInstall() {}
+
+#define ALLOC_PHASE(phase) ((void)0)
+
+#endif
+
+#endif
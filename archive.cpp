@@ -0,0 +1,360 @@
+#include "codec.h"
+#include "replay.h"
+#include "watchdog.h"
+#include "varint.h"
+#include "log.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+// Packs replays and flight recorder dumps into one entropy-coded archive, a fifth of
+// their varint size for long games without keyframes (see codec.h), and benchmarks the
+// codec against varints.
+//
+//   archive pack out.snza files...     every entry is decoded again and checked before writing
+//   archive unpack in.snza prefix      writes <prefix>_NNN.snr / .bin
+//   archive bench [--repeat N] files...
+//
+// An archive is "SNZA", then per entry a varint kind (0 replay, 1 flight dump), varint
+// blob length and the blob.
+
+enum EntryKind { ENTRY_REPLAY = 0, ENTRY_FLIGHT = 1 };
+
+const int DEFAULT_REPEAT = 20;
+
+static bool readFile(const string& path, vector<uint8_t>& data) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        LOG_ERROR("Failed to open %s", path);
+        return false;
+    }
+    data.clear();
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(file);
+    return true;
+}
+
+static bool writeFile(const string& path, const vector<uint8_t>& data) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        LOG_ERROR("Failed to create %s", path);
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return fclose(file) == 0 && ok;
+}
+
+static bool readFlight(const vector<uint8_t>& data, FlightHeader& header, vector<TickRecord>& records) {
+    if (data.size() < sizeof(FlightHeader)) {
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (memcmp(header.magic, "SNFR", 4) != 0 || header.recordSize != sizeof(TickRecord)
+        || header.count > (data.size() - sizeof(header)) / sizeof(TickRecord)) {
+        return false;
+    }
+    records.resize(header.count);
+    memcpy(records.data(), data.data() + sizeof(header), header.count * sizeof(TickRecord));
+    return true;
+}
+
+static void writeFlight(const FlightHeader& header, const vector<TickRecord>& records, vector<uint8_t>& out) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&header);
+    out.insert(out.end(), bytes, bytes + sizeof(header));
+    bytes = reinterpret_cast<const uint8_t*>(records.data());
+    out.insert(out.end(), bytes, bytes + records.size() * sizeof(TickRecord));
+}
+
+// The baseline a dump is measured against: each field as a zigzag varint delta from the
+// previous record
+static void varintTicks(const vector<TickRecord>& records, vector<uint8_t>& out) {
+    TickRecord previous;
+    memset(&previous, 0, sizeof(previous));
+    for (const auto& r : records) {
+        putVarint(out, zigzag(static_cast<int64_t>(r.tick) - previous.tick));
+        putVarint(out, r.eventsUs);
+        putVarint(out, r.updateUs);
+        putVarint(out, r.renderUs);
+        putVarint(out, r.totalUs);
+        putVarint(out, r.events);
+        putVarint(out, zigzag(r.snakeLength - previous.snakeLength));
+        putVarint(out, zigzag(static_cast<int64_t>(r.score) - previous.score));
+        previous = r;
+    }
+}
+
+static bool sameReplay(const Replay& a, const Replay& b) {
+    if (memcmp(&a.header.level, &b.header.level, sizeof(ReplayHeader) - 6) != 0 || a.complete != b.complete
+        || a.ticks != b.ticks || a.score != b.score || a.died != b.died || a.inputs.size() != b.inputs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.inputs.size(); ++i) {
+        if (a.inputs[i].tick != b.inputs[i].tick || a.inputs[i].dir != b.inputs[i].dir) {
+            return false;
+        }
+    }
+    if (a.hashes.size() != b.hashes.size() || a.keyframes.size() != b.keyframes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.hashes.size(); ++i) {
+        if (a.hashes[i].tick != b.hashes[i].tick || a.hashes[i].hash != b.hashes[i].hash) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < a.keyframes.size(); ++i) {
+        if (a.keyframes[i].tick != b.keyframes[i].tick || a.keyframes[i].state != b.keyframes[i].state) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool sameFlight(const FlightHeader& a, const vector<TickRecord>& x, const FlightHeader& b,
+                       const vector<TickRecord>& y) {
+    return memcmp(&a, &b, sizeof(a)) == 0 && x.size() == y.size()
+           && memcmp(x.data(), y.data(), x.size() * sizeof(TickRecord)) == 0;
+}
+
+// One entry's blob, decoded again to be sure it round-trips
+static bool packEntry(const string& path, vector<uint8_t>& archive, uint64_t& inBytes) {
+    vector<uint8_t> data, blob;
+    if (!readFile(path, data)) {
+        return false;
+    }
+    inBytes += data.size();
+    FlightHeader header;
+    vector<TickRecord> records;
+    if (readFlight(data, header, records)) {
+        compressTicks(header, records.data(), blob);
+        FlightHeader checkHeader;
+        vector<TickRecord> check;
+        if (!decompressTicks(blob.data(), blob.size(), checkHeader, check)
+            || !sameFlight(header, records, checkHeader, check)) {
+            LOG_ERROR("%s does not round-trip", path);
+            return false;
+        }
+        putVarint(archive, ENTRY_FLIGHT);
+    } else {
+        Replay replay, check;
+        if (!loadReplay(path.c_str(), replay)) {
+            return false;
+        }
+        compressReplay(replay, blob);
+        if (!decompressReplay(blob.data(), blob.size(), check) || !sameReplay(replay, check)) {
+            LOG_ERROR("%s does not round-trip", path);
+            return false;
+        }
+        putVarint(archive, ENTRY_REPLAY);
+    }
+    putVarint(archive, blob.size());
+    archive.insert(archive.end(), blob.begin(), blob.end());
+    return true;
+}
+
+static int pack(const string& out, const vector<string>& paths) {
+    vector<uint8_t> archive = { 'S', 'N', 'Z', 'A' };
+    uint64_t inBytes = 0;
+    for (const auto& path : paths) {
+        if (!packEntry(path, archive, inBytes)) {
+            return 1;
+        }
+    }
+    if (!writeFile(out, archive)) {
+        return 1;
+    }
+    cout << "Packed " << paths.size() << " files, " << inBytes << " bytes into " << archive.size() << " ("
+         << fixed << setprecision(1) << 100.0 * archive.size() / max<uint64_t>(inBytes, 1) << "%)" << endl;
+    return 0;
+}
+
+static int unpack(const string& in, const string& prefix) {
+    vector<uint8_t> archive;
+    if (!readFile(in, archive)) {
+        return 1;
+    }
+    if (archive.size() < 4 || memcmp(archive.data(), "SNZA", 4) != 0) {
+        cout << in << " is not an archive" << endl;
+        return 1;
+    }
+    size_t pos = 4;
+    int entries = 0;
+    uint64_t kind, length;
+    while (pos < archive.size()) {
+        if (!getVarint(archive.data(), archive.size(), pos, kind) || !getVarint(archive.data(), archive.size(), pos, length)
+            || length > archive.size() - pos) {
+            cout << in << " is truncated after " << entries << " entries" << endl;
+            return 1;
+        }
+        const uint8_t* blob = archive.data() + pos;
+        pos += length;
+        vector<uint8_t> data;
+        const char* extension;
+        if (kind == ENTRY_REPLAY) {
+            Replay replay;
+            if (!decompressReplay(blob, length, replay)) {
+                cout << "Entry " << entries << " is corrupt" << endl;
+                return 1;
+            }
+            encodeReplay(replay, data);
+            extension = ".snr";
+        } else if (kind == ENTRY_FLIGHT) {
+            FlightHeader header;
+            vector<TickRecord> records;
+            if (!decompressTicks(blob, length, header, records)) {
+                cout << "Entry " << entries << " is corrupt" << endl;
+                return 1;
+            }
+            writeFlight(header, records, data);
+            extension = ".bin";
+        } else {
+            cout << "Entry " << entries << " has unknown kind " << kind << endl;
+            return 1;
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "_%03d", entries);
+        if (!writeFile(prefix + name + extension, data)) {
+            return 1;
+        }
+        entries++;
+    }
+    cout << "Unpacked " << entries << " files" << endl;
+    return 0;
+}
+
+struct BenchTotals {
+    int files = 0;
+    uint64_t raw = 0;           // bytes as the game writes them
+    uint64_t varint = 0;        // the varint baseline
+    uint64_t coded = 0;
+    double varintSeconds = 0;   // encode + decode, all repeats
+    double codedSeconds = 0;
+};
+
+static void report(const char* name, const BenchTotals& t, int repeat) {
+    if (t.files == 0) {
+        return;
+    }
+    double mb = static_cast<double>(t.varint) * repeat / 1e6;
+    cout << name << ": " << t.files << " files, raw " << t.raw << " bytes, varint " << t.varint << ", coded "
+         << t.coded << fixed << setprecision(2) << " (" << static_cast<double>(t.varint) / max<uint64_t>(t.coded, 1)
+         << "x smaller than varint, " << static_cast<double>(t.raw) / max<uint64_t>(t.coded, 1) << "x than raw)" << endl;
+    cout << "  varint " << setprecision(1) << mb / max(t.varintSeconds, 1e-9) << " MB/s, coded "
+         << mb / max(t.codedSeconds, 1e-9) << " MB/s (encode + decode, per varint byte)" << endl;
+}
+
+static int bench(const vector<string>& paths, int repeat) {
+    BenchTotals replays, flights;
+    typedef chrono::steady_clock Clock;
+    vector<uint8_t> data, out;
+    for (const auto& path : paths) {
+        if (!readFile(path, data)) {
+            return 1;
+        }
+        FlightHeader header;
+        vector<TickRecord> records;
+        if (readFlight(data, header, records)) {
+            flights.files++;
+            flights.raw += data.size();
+            auto start = Clock::now();
+            for (int i = 0; i < repeat; ++i) {
+                out.clear();
+                varintTicks(records, out);
+                size_t pos = 0;
+                uint64_t value;
+                while (getVarint(out.data(), out.size(), pos, value)) {}
+            }
+            flights.varintSeconds += chrono::duration<double>(Clock::now() - start).count();
+            flights.varint += out.size();
+            start = Clock::now();
+            for (int i = 0; i < repeat; ++i) {
+                out.clear();
+                compressTicks(header, records.data(), out);
+                decompressTicks(out.data(), out.size(), header, records);
+            }
+            flights.codedSeconds += chrono::duration<double>(Clock::now() - start).count();
+            flights.coded += out.size();
+            continue;
+        }
+        Replay replay;
+        if (!loadReplay(path.c_str(), replay)) {
+            return 1;
+        }
+        replays.files++;
+        replays.raw += data.size();
+        auto start = Clock::now();
+        Replay decoded;
+        for (int i = 0; i < repeat; ++i) {
+            out.clear();
+            encodeReplay(replay, out);
+            size_t pos = sizeof(ReplayHeader);
+            uint64_t value, tick = 0;
+            decoded.inputs.clear();
+            uint64_t skip, length;
+            while (getVarint(out.data(), out.size(), pos, value) && value != REPLAY_END) {
+                if (value == REPLAY_HASH) {
+                    getVarint(out.data(), out.size(), pos, skip);
+                    pos += 8;
+                } else if (value == REPLAY_KEYFRAME) {
+                    getVarint(out.data(), out.size(), pos, skip);
+                    getVarint(out.data(), out.size(), pos, length);
+                    pos += length;
+                } else {
+                    tick += (value >> 2) - 1;
+                    decoded.inputs.push_back({ static_cast<uint32_t>(tick - 1), static_cast<uint8_t>(value & 3) });
+                }
+            }
+        }
+        replays.varintSeconds += chrono::duration<double>(Clock::now() - start).count();
+        replays.varint += out.size();
+        start = Clock::now();
+        for (int i = 0; i < repeat; ++i) {
+            out.clear();
+            compressReplay(replay, out);
+            decompressReplay(out.data(), out.size(), decoded);
+        }
+        replays.codedSeconds += chrono::duration<double>(Clock::now() - start).count();
+        replays.coded += out.size();
+        if (!sameReplay(replay, decoded)) {
+            cout << path << ": does not round-trip" << endl;
+            return 1;
+        }
+    }
+    report("Replays", replays, repeat);
+    report("Flight dumps", flights, repeat);
+    return 0;
+}
+
+int main(int argc, char* args[]) {
+    vector<string> params;
+    int repeat = DEFAULT_REPEAT;
+    for (int i = 1; i < argc; ++i) {
+        string arg = args[i];
+        if (arg == "--repeat" && i + 1 < argc) {
+            repeat = max(1, atoi(args[++i]));
+        } else {
+            params.push_back(arg);
+        }
+    }
+    int status = 2;
+    if (params.size() >= 3 && params[0] == "pack") {
+        status = pack(params[1], vector<string>(params.begin() + 2, params.end()));
+    } else if (params.size() == 3 && params[0] == "unpack") {
+        status = unpack(params[1], params[2]);
+    } else if (params.size() >= 2 && params[0] == "bench") {
+        status = bench(vector<string>(params.begin() + 1, params.end()), repeat);
+    } else {
+        cout << "usage: archive pack out.snza files... | unpack in.snza prefix | bench [--repeat N] files..." << endl;
+    }
+    logFlush();
+    return status;
+}
@@ -0,0 +1,327 @@
+#include "autopilot.h"
+#include <algorithm>
+
+using namespace std;
+
+const int STEP_X[4] = { 0, 0, -1, 1 };     // by Direction
+const int STEP_Y[4] = { -1, 1, 0, 0 };
+
+Autopilot::Autopilot(int boardWidth, int boardHeight)
+    : cellsX(boardWidth / CELL_SIZE), cellsY(boardHeight / CELL_SIZE), cells(cellsX * cellsY), seen(cells, 0),
+      parent(cells, -1), depth(cells, 0), queue(cells, 0), bodyStamp(cells, 0), freeAt(cells, 0), stamp(0),
+      bodyGeneration(0), pathNext(0), pathFood({ 0, 0 }), pathTick(0), retryTick(0), enemies(boardWidth, boardHeight) {
+    path.reserve(cells);
+}
+
+void Autopilot::clear() {
+    path.clear();
+    pathNext = 0;
+    retryTick = 0;
+    enemies.clear();
+}
+
+int Autopilot::cellOf(const Point& p) const {
+    if (p.x < 0 || p.y < 0 || p.x >= cellsX * CELL_SIZE || p.y >= cellsY * CELL_SIZE) {
+        return -1;
+    }
+    return (p.y / CELL_SIZE) * cellsX + p.x / CELL_SIZE;
+}
+
+Direction Autopilot::towards(const Point& from, int cell) const {
+    int dx = (cell % cellsX) * CELL_SIZE - from.x;
+    int dy = (cell / cellsX) * CELL_SIZE - from.y;
+    if (dx != 0) {
+        return dx > 0 ? RIGHT : LEFT;
+    }
+    return dy > 0 ? DOWN : UP;
+}
+
+Direction Autopilot::decide(const Simulation& sim) {
+    counters.decisions++;
+    counters.lastNodes = 0;
+    if (sim.snake.empty() || sim.gameOver) {
+        return sim.dir;
+    }
+    if (sim.level3 && enemies.update(sim)) {
+        path.clear();//the enemies did something the path did not allow for
+    }
+    const Point& head = sim.snake[0];
+    if (pathStillGood(sim, cellOf(head))) {
+        pathTick = sim.tick + 1;
+        return towards(head, path[pathNext++]);
+    }
+
+    counters.searches++;
+    markBody(sim);
+    Direction choice = sim.dir;
+    uint32_t nodes = 0;
+    path.clear();
+    if (sim.tick >= retryTick) {
+        nodes = search(sim, cellOf(sim.food), -1, cells);
+    }
+    if (!path.empty()) {
+        pathNext = 0;
+        pathFood = sim.food;
+        pathTick = sim.tick + 1;
+        choice = towards(head, path[pathNext++]);
+    } else {
+        //No way to the food for now: keep to a side with room for the whole body, and only
+        //look for the food again every few ticks, as a failed search covers everything reachable
+        if (sim.tick >= retryTick) {
+            retryTick = sim.tick + AUTOPILOT_RETRY_TICKS;
+        }
+        uint32_t enough = static_cast<uint32_t>(sim.snake.size()) + 1;
+        uint32_t best = 0;
+        for (int d = 0; d < 4 && best < enough; ++d) {
+            int cell = cellOf({ head.x + STEP_X[d] * CELL_SIZE, head.y + STEP_Y[d] * CELL_SIZE });
+            if (cell < 0 || !passable(sim, cell, 1)) {
+                continue;
+            }
+            uint32_t room = search(sim, -1, cell, enough);
+            nodes += room;
+            if (room > best) {
+                best = room;
+                choice = static_cast<Direction>(d);
+            }
+        }
+    }
+    counters.lastNodes = nodes;
+    counters.nodesExpanded += nodes;
+    counters.maxNodes = max(counters.maxNodes, nodes);
+    return choice;
+}
+
+// The path is what the last search predicted; it only needs checking one cell ahead,
+// which also catches anything the search could not foresee
+bool Autopilot::pathStillGood(const Simulation& sim, int head) {
+    if (pathNext == 0 || pathNext >= path.size() || sim.tick != pathTick || sim.food.x != pathFood.x
+        || sim.food.y != pathFood.y || head != path[pathNext - 1]) {
+        path.clear();
+        return false;
+    }
+    int next = path[pathNext];
+    Point cell = { (next % cellsX) * CELL_SIZE, (next / cellsX) * CELL_SIZE };
+    if (sim.checkCollision(cell) || (sim.level3 && enemies.crosses(next, 2, static_cast<uint32_t>(sim.snake.size()) + 2))) {
+        path.clear();
+        return false;
+    }
+    return true;
+}
+
+// A body segment i cells behind the head is gone after size - i more steps; the tail
+// still counts in the step that moves it, as it does in checkCollision()
+void Autopilot::markBody(const Simulation& sim) {
+    if (++bodyGeneration == 0) {
+        fill(bodyStamp.begin(), bodyStamp.end(), 0);
+        bodyGeneration = 1;
+    }
+    uint32_t length = static_cast<uint32_t>(sim.snake.size());
+    for (uint32_t i = 0; i < length; ++i) {
+        int cell = cellOf(sim.snake[i]);
+        if (cell >= 0) {
+            bodyStamp[cell] = bodyGeneration;
+            freeAt[cell] = length - i + 1;
+        }
+    }
+}
+
+// Whether the head can be on the cell depth steps from now. On level 3 an enemy head
+// kills the snake by moving onto its body, so the cell must also stay clear of them for
+// as long as the body will lie on it, one more step in case it grows.
+bool Autopilot::passable(const Simulation& sim, int cell, uint32_t at) const {
+    if (bodyStamp[cell] == bodyGeneration && at < freeAt[cell]) {
+        return false;
+    }
+    if (sim.level2 && sim.occupied({ (cell % cellsX) * CELL_SIZE, (cell / cellsX) * CELL_SIZE }, OCCUPIED_OBSTACLE)) {
+        return false;
+    }
+    if (sim.level3) {
+        return !enemies.crosses(cell, at + 1, at + static_cast<uint32_t>(sim.snake.size()) + 1);
+    }
+    return true;
+}
+
+// Breadth-first from the cells next to the head, or from firstCell alone, until the
+// target is taken off the queue and its path is in path, or limit cells have been
+// expanded (target -1 just counts the room). A cell that is blocked when first reached
+// stays unseen, so a longer way round can still enter it once the body has moved on.
+// Returns the cells expanded.
+uint32_t Autopilot::search(const Simulation& sim, int target, int firstCell, uint32_t limit) {
+    if (++stamp == 0) {
+        fill(seen.begin(), seen.end(), 0);
+        stamp = 1;
+    }
+    size_t front = 0, back = 0;
+    auto push = [&](int cell, int from, uint32_t at) {
+        seen[cell] = stamp;
+        parent[cell] = from;
+        depth[cell] = at;
+        queue[back++] = cell;
+    };
+    if (firstCell >= 0) {
+        push(firstCell, -1, 1);
+    } else {
+        const Point& head = sim.snake[0];
+        for (int d = 0; d < 4; ++d) {
+            int cell = cellOf({ head.x + STEP_X[d] * CELL_SIZE, head.y + STEP_Y[d] * CELL_SIZE });
+            if (cell >= 0 && seen[cell] != stamp && passable(sim, cell, 1)) {
+                push(cell, -1, 1);
+            }
+        }
+    }
+
+    uint32_t nodes = 0;
+    while (front < back && nodes < limit) {
+        int cell = queue[front++];
+        nodes++;
+        if (cell == target) {
+            for (int at = cell; at >= 0; at = parent[at]) {
+                path.push_back(at);
+            }
+            reverse(path.begin(), path.end());
+            break;
+        }
+        int x = cell % cellsX, y = cell / cellsX;
+        uint32_t next = depth[cell] + 1;
+        for (int d = 0; d < 4; ++d) {
+            int nx = x + STEP_X[d], ny = y + STEP_Y[d];
+            if (nx < 0 || ny < 0 || nx >= cellsX || ny >= cellsY) {
+                continue;
+            }
+            int neighbour = ny * cellsX + nx;
+            if (seen[neighbour] != stamp && passable(sim, neighbour, next)) {
+                push(neighbour, cell, next);
+            }
+        }
+    }
+    return nodes;
+}
+
+EnemyForecast::EnemyForecast(int boardWidth, int boardHeight)
+    : cellsX(boardWidth / CELL_SIZE), cellsY(boardHeight / CELL_SIZE), cycleStart(0), forecastTick(0), now(0),
+      enemyX(0), enemyY(0), limit(16 * static_cast<size_t>(cellsX + cellsY) + 1024), stamp(0) {
+    size_t cells = static_cast<size_t>(cellsX) * cellsY;
+    forecast.reserve(limit);
+    visitStart.reserve(cells + 1);
+    visits.reserve(2 * limit);
+    fillAt.reserve(cells);
+    size_t slots = 1;
+    while (slots < 2 * limit) {
+        slots *= 2;
+    }
+    seenKey.assign(slots, 0);
+    seenStep.assign(slots, 0);
+    seenStamp.assign(slots, 0);
+}
+
+int EnemyForecast::cellOf(const Point& p) const {
+    if (p.x < 0 || p.y < 0 || p.x >= cellsX * CELL_SIZE || p.y >= cellsY * CELL_SIZE) {
+        return -1;
+    }
+    return (p.y / CELL_SIZE) * cellsX + p.x / CELL_SIZE;
+}
+
+// Whether the enemies were in this state earlier in the forecast, and at which step;
+// otherwise it is added as the next step
+bool EnemyForecast::seenBefore(uint64_t key, size_t& at) {
+    size_t mask = seenKey.size() - 1;
+    size_t slot = static_cast<size_t>((key * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+    while (seenStamp[slot] == stamp) {
+        if (seenKey[slot] == key) {
+            at = seenStep[slot];
+            return true;
+        }
+        slot = (slot + 1) & mask;
+    }
+    seenStamp[slot] = stamp;
+    seenKey[slot] = key;
+    seenStep[slot] = static_cast<uint32_t>(at);
+    return false;
+}
+
+// The heads are played forward until their state repeats, a few board crossings. Redone
+// only when the game did something the forecast did not, such as a reset or a rewind.
+bool EnemyForecast::update(const Simulation& sim) {
+    const Point& head1 = sim.enemy1[0];
+    const Point& head2 = sim.enemy2[0];
+    if (!forecast.empty() && sim.tick >= forecastTick && head1.x == enemyX && head2.y == enemyY) {
+        size_t k = sim.tick - forecastTick;
+        if (k >= forecast.size() && cycleStart < forecast.size()) {
+            k = cycleStart + (k - cycleStart) % (forecast.size() - cycleStart);
+        }
+        if (k < forecast.size() && forecast[k].y1 == head1.y && forecast[k].x2 == head2.x
+            && forecast[k].heading == sim.dir2) {
+            now = static_cast<uint32_t>(sim.tick - forecastTick);
+            return false;
+        }
+    }
+
+    forecast.clear();
+    forecastTick = sim.tick;
+    now = 0;
+    enemyX = head1.x;
+    enemyY = head2.y;
+    if (++stamp == 0) {
+        fill(seenStamp.begin(), seenStamp.end(), 0);
+        stamp = 1;
+    }
+    Point a = head1, b = head2;
+    Direction heading = sim.dir2;
+    cycleStart = limit;
+    while (forecast.size() < limit) {
+        uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(a.y)) << 32)
+                       | static_cast<uint32_t>(b.x * 2 + (heading == DOWN ? 1 : 0));
+        size_t at = forecast.size();
+        if (seenBefore(key, at)) {
+            cycleStart = at;
+            break;
+        }
+        forecast.push_back({ a.y, b.x, heading });
+        sim.moveEnemyHeads(a, b, heading);
+    }
+    cycleStart = min(cycleStart, forecast.size());
+
+    //Per cell, the forecast steps with an enemy head on it
+    int cells = cellsX * cellsY;
+    visitStart.assign(cells + 1, 0);
+    for (const auto& state : forecast) {
+        int cell1 = cellOf({ enemyX, state.y1 }), cell2 = cellOf({ state.x2, enemyY });
+        if (cell1 >= 0) visitStart[cell1 + 1]++;
+        if (cell2 >= 0) visitStart[cell2 + 1]++;
+    }
+    for (int i = 0; i < cells; ++i) {
+        visitStart[i + 1] += visitStart[i];
+    }
+    visits.resize(visitStart[cells]);
+    fillAt.assign(visitStart.begin(), visitStart.end() - 1);
+    for (size_t k = 0; k < forecast.size(); ++k) {
+        int cell1 = cellOf({ enemyX, forecast[k].y1 }), cell2 = cellOf({ forecast[k].x2, enemyY });
+        if (cell1 >= 0) visits[fillAt[cell1]++] = static_cast<uint32_t>(k);
+        if (cell2 >= 0) visits[fillAt[cell2]++] = static_cast<uint32_t>(k);
+    }
+    return true;
+}
+
+// Forecast steps past one that never repeated are taken as clear
+bool EnemyForecast::crosses(int cell, uint32_t from, uint32_t to) const {
+    if (forecast.empty()) {
+        return false;
+    }
+    from += now;
+    to += now;
+    size_t period = forecast.size() - cycleStart;
+    for (uint32_t i = visitStart[cell]; i < visitStart[cell + 1]; ++i) {
+        uint32_t k = visits[i];
+        if (k >= from) {
+            if (k <= to) {
+                return true;
+            }
+        } else if (k >= cycleStart && period > 0) {
+            uint32_t laps = static_cast<uint32_t>((from - k + period - 1) / period);
+            if (k + laps * period <= to) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
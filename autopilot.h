@@ -0,0 +1,107 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A bot for attract mode and load generation: steers by the shortest path to the food,
+// found by a breadth-first search over the board cells. The search knows when each body
+// cell will have moved on, so the snake may follow its own tail, and on level 3 it keeps
+// the head off cells an enemy head will cross while the body still lies there.
+//
+// The path is kept between ticks. Following it plays out exactly as the search predicted,
+// so it is only searched again once the food has been eaten, or when the next cell turns
+// out to be blocked or the snake is not where the path expected (a key press, a rewind,
+// a new game). Every search uses arrays sized for the board up front and told apart by a
+// generation stamp, and so does a new enemy forecast, so a decision neither allocates nor
+// clears anything.
+
+// Where the level 3 enemy heads will be. They ignore the snake, so they can be played
+// forward on their own; the forecast is kept until the game does something it did not
+// predict. Cells are y * cellsX + x, as in the bots.
+class EnemyForecast {
+public:
+    EnemyForecast(int boardWidth, int boardHeight);
+    bool update(const Simulation& sim);     // once per tick before crosses(), true if it was redone
+    bool crosses(int cell, uint32_t from, uint32_t to) const;   // an enemy head on it after any of steps from..to
+    void clear() { forecast.clear(); }
+
+private:
+    int cellOf(const Point& p) const;
+    bool seenBefore(uint64_t key, size_t& at);
+
+    struct EnemyState {
+        int y1;                         // enemy1 moves along its column, enemy2 along its row
+        int x2;
+        Direction heading;
+    };
+    int cellsX;
+    int cellsY;
+    std::vector<EnemyState> forecast;   // from forecastTick on
+    size_t cycleStart;                  // forecast repeats from here; forecast.size() if it never did
+    uint32_t forecastTick;
+    uint32_t now;                       // sim.tick - forecastTick at the last update()
+    int enemyX;                         // enemy1's column and enemy2's row, in pixels
+    int enemyY;
+    size_t limit;                       // forecast steps at most
+    std::vector<uint32_t> visitStart;   // per cell, into visits
+    std::vector<uint32_t> visits;       // forecast steps at which an enemy head is on the cell
+    std::vector<uint32_t> fillAt;
+    std::vector<uint64_t> seenKey;      // enemy states forecast so far, open addressing
+    std::vector<uint32_t> seenStep;
+    std::vector<uint32_t> seenStamp;
+    uint32_t stamp;
+};
+
+const uint32_t AUTOPILOT_RETRY_TICKS = 8;  // between searches while the food is out of reach
+
+struct AutopilotStats {
+    uint64_t decisions = 0;
+    uint64_t searches = 0;          // decisions that could not reuse the path
+    uint64_t nodesExpanded = 0;     // cells taken off the search queue, over all decisions
+    uint32_t lastNodes = 0;         // in the last decision
+    uint32_t maxNodes = 0;          // in any one decision
+};
+
+class Autopilot {
+public:
+    Autopilot(int boardWidth, int boardHeight);
+    Direction decide(const Simulation& sim);    // the direction for sim's next step()
+    void clear();                               // forget the path, e.g. for a new game
+    const AutopilotStats& stats() const { return counters; }
+
+private:
+    int cellOf(const Point& p) const;
+    bool pathStillGood(const Simulation& sim, int head);
+    bool passable(const Simulation& sim, int cell, uint32_t depth) const;
+    uint32_t search(const Simulation& sim, int target, int firstCell, uint32_t limit);
+    void markBody(const Simulation& sim);
+    Direction towards(const Point& from, int cell) const;
+
+    int cellsX;
+    int cellsY;
+    int cells;
+
+    std::vector<uint32_t> seen;         // stamp of the search that reached the cell
+    std::vector<int32_t> parent;
+    std::vector<uint32_t> depth;
+    std::vector<int32_t> queue;
+    std::vector<uint32_t> bodyStamp;
+    std::vector<uint32_t> freeAt;       // depth from which a body cell may be entered
+    uint32_t stamp;
+    uint32_t bodyGeneration;
+
+    std::vector<int32_t> path;          // cells from the first move to the food
+    size_t pathNext;                    // index of the next cell to enter
+    Point pathFood;
+    uint32_t pathTick;                  // sim.tick the next decision should see
+    uint32_t retryTick;                 // no search for the food before this tick
+
+    EnemyForecast enemies;
+
+    AutopilotStats counters;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "simulation.h"
+#include "autopilot.h"
+#include "hamilton.h"
+#include "log.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace std;
+
+// Games played by the bots with no SDL and no tick delay, to see how well and how fast
+// they play: score, ticks per food eaten and time per decision, and for the autopilot
+// (bfs) how often the cached path had to be searched again and the cells each decision
+// expanded, for the Hamiltonian cycle solver (cycle) its cycle and shortcuts, with level 3
+// reported as unsupported (see hamilton.h). Runs both on every level of a 32x24 board and
+// of one with 100 times the cells unless --bot, --board and --level say otherwise.
+//
+//   autoplay [--bot bfs|cycle] [--board WxH] [--level N] [--games N] [--ticks N] [--seed N]
+
+const int DEFAULT_GAMES = 20;
+const uint32_t DEFAULT_TICKS = 20000;          // a game that runs this long is stopped
+const uint32_t DEFAULT_CYCLE_TICKS = 200000;    // the cycle bot rarely dies below level 3, and fills a 32x24 board in less
+
+struct Totals {
+    int games = 0;
+    int died = 0;
+    int filled = 0;             // games that ran out of room for food
+    uint64_t score = 0;
+    uint64_t ticks = 0;
+    double seconds = 0;         // in decide(), all games
+    double worstUs = 0;         // slowest single decision
+};
+
+template <class Bot>
+static Totals play(Bot& bot, Simulation& sim, int games, uint32_t maxTicks, uint64_t seed) {
+    Totals totals;
+    typedef chrono::steady_clock Clock;
+    for (int game = 0; game < games; ++game) {
+        sim.reset(seed + game);
+        bot.clear();
+        while (!sim.gameOver && sim.tick < maxTicks && sim.food.x >= 0) {
+            auto start = Clock::now();
+            sim.dir = bot.decide(sim);
+            double seconds = chrono::duration<double>(Clock::now() - start).count();
+            totals.seconds += seconds;
+            totals.worstUs = max(totals.worstUs, seconds * 1e6);
+            sim.step();
+        }
+        totals.games++;
+        totals.died += sim.gameOver ? 1 : 0;
+        totals.filled += sim.food.x < 0 ? 1 : 0;
+        totals.score += sim.score;
+        totals.ticks += sim.tick;
+    }
+    return totals;
+}
+
+static void report(const char* bot, const Simulation& sim, int level, const Totals& totals, uint64_t decisions) {
+    uint64_t eaten = totals.score / 10;
+    cout << bot << " " << sim.boardWidth / CELL_SIZE << "x" << sim.boardHeight / CELL_SIZE << " level " << level
+         << ": " << totals.games << " games, " << totals.died << " died, " << totals.filled << " filled the board, mean score "
+         << fixed << setprecision(1) << static_cast<double>(totals.score) / totals.games << ", mean ticks "
+         << static_cast<double>(totals.ticks) / totals.games << ", " << static_cast<double>(totals.ticks) / max<uint64_t>(eaten, 1)
+         << " ticks per food" << endl;
+    cout << "  " << setprecision(3) << totals.seconds * 1e6 / max<uint64_t>(decisions, 1) << " us per decision, "
+         << totals.worstUs << " us worst" << endl;
+}
+
+static void playBfs(int cellsX, int cellsY, int level, int games, uint32_t maxTicks, uint64_t seed) {
+    Simulation sim(cellsX * CELL_SIZE, cellsY * CELL_SIZE);
+    Autopilot pilot(sim.boardWidth, sim.boardHeight);
+    sim.setLevel(level);
+    Totals totals = play(pilot, sim, games, maxTicks, seed);
+
+    const AutopilotStats& stats = pilot.stats();
+    double decisions = static_cast<double>(max<uint64_t>(stats.decisions, 1));
+    report("bfs", sim, level, totals, stats.decisions);
+    cout << "  " << stats.decisions << " decisions, " << setprecision(2) << 100.0 * stats.searches / decisions
+         << "% searched, nodes expanded " << stats.nodesExpanded / decisions << " per decision, "
+         << static_cast<double>(stats.nodesExpanded) / max<uint64_t>(stats.searches, 1) << " per search, "
+         << stats.maxNodes << " max" << endl;
+}
+
+static void playCycle(int cellsX, int cellsY, int level, int games, uint32_t maxTicks, uint64_t seed) {
+    Simulation sim(cellsX * CELL_SIZE, cellsY * CELL_SIZE);
+    HamiltonSolver solver(sim.boardWidth, sim.boardHeight);
+    sim.setLevel(level);
+    sim.reset(seed);
+    const HamiltonCycle& cycle = solver.cycleFor(sim);
+    Totals totals = play(solver, sim, games, maxTicks, seed);
+
+    const HamiltonStats& stats = solver.stats();
+    double decisions = static_cast<double>(max<uint64_t>(stats.decisions, 1));
+    report("cycle", sim, level, totals, stats.decisions);
+    cout << "  cycle of " << cycle.cells.size() << " cells built in " << setprecision(3) << cycle.buildMs << " ms ("
+         << stats.builds << " built), " << cycle.missed << " food cells off it; " << setprecision(2)
+         << 100.0 * stats.shortcuts / decisions << "% shortcuts, " << 100.0 * stats.dodges / decisions << "% dodges, "
+         << 100.0 * stats.fallbacks / decisions << "% left to the autopilot" << endl;
+    if (level == 3) {
+        cout << "  level 3 is unsupported, best effort only: the enemies are back on every cell of their column and row "
+             << "within " << enemyRevisitTicks(sim) << " ticks, so a longer snake is hit wherever it crosses them" << endl;
+    }
+}
+
+int main(int argc, char* args[]) {
+    vector<pair<int, int>> boards = { { 32, 24 }, { 320, 240 } };
+    string bot;
+    int onlyLevel = 0;
+    int games = DEFAULT_GAMES;
+    uint32_t ticks = 0;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        string arg = args[i];
+        int w, h;
+        if (arg == "--board" && i + 1 < argc && sscanf(args[i + 1], "%dx%d", &w, &h) == 2 && w >= 4 && h >= 4) {
+            boards = { { w, h } };
+            ++i;
+        } else if (arg == "--bot" && i + 1 < argc) {
+            bot = args[++i];
+        } else if (arg == "--level" && i + 1 < argc) {
+            onlyLevel = atoi(args[++i]);
+        } else if (arg == "--games" && i + 1 < argc) {
+            games = max(1, atoi(args[++i]));
+        } else if (arg == "--ticks" && i + 1 < argc) {
+            ticks = static_cast<uint32_t>(max(1, atoi(args[++i])));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = strtoull(args[++i], nullptr, 10);
+        } else {
+            bot = "?";
+            break;
+        }
+    }
+    if (bot != "" && bot != "bfs" && bot != "cycle") {
+        cout << "usage: autoplay [--bot bfs|cycle] [--board WxH] [--level N] [--games N] [--ticks N] [--seed N]" << endl;
+        return 2;
+    }
+
+    for (const auto& board : boards) {
+        for (int level = 1; level <= 3; ++level) {
+            if (onlyLevel != 0 && onlyLevel != level) {
+                continue;
+            }
+            if (bot != "cycle") {
+                playBfs(board.first, board.second, level, games, ticks != 0 ? ticks : DEFAULT_TICKS, seed);
+            }
+            if (bot != "bfs") {
+                playCycle(board.first, board.second, level, games, ticks != 0 ? ticks : DEFAULT_CYCLE_TICKS, seed);
+            }
+        }
+    }
+    logFlush();
+    return 0;
+}
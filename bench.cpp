@@ -0,0 +1,346 @@
+#include "game.h"
+#include "alloc.h"
+#include "bodychain.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+
+using namespace std;
+
+// Microbenchmarks for the game's hot paths. Runs headless (dummy drivers, software renderer)
+// and writes per-operation percentiles as JSON so builds can be compared.
+
+struct BenchResult {
+    string name;
+    int level;
+    int cellsX;
+    int cellsY;
+    int length;
+    vector<double> samples;   // ns per iteration
+};
+
+class GameBench {
+public:
+    GameBench(SnakeGame& game) : game(game), nextHead({ 0, 0 }), bodyDir(UP) {}
+
+    bool setup(int level, int length);
+    void prepare();
+    bool allocCheck(int level, int warmupTicks, int ticks);
+    void update() { game.update(); }
+    void spawnFood() { game.sim.spawnFood(); }
+    bool checkCollision() { return game.sim.checkCollision(nextHead); }
+    void saveSnapshot() { ::saveSnapshot(game.sim, snapshot); }
+    bool loadSnapshot() { return ::loadSnapshot(snapshot.data(), snapshot.size(), game.sim); }
+    void render() { game.render(); }
+    void renderText() {
+        SDL_Color black = { 0, 0, 0, 255 };
+        game.renderText("Score: 12340", 10, 10, black);
+    }
+
+private:
+    SnakeGame& game;
+    vector<Point> body;
+    Point nextHead;
+    Direction bodyDir;
+    vector<uint8_t> snapshot;
+};
+
+// Lays the snake out as a serpentine over the bottom half of the board, below the level 2
+// obstacle and out of the enemies' way, with its head pointing at a free cell.
+bool GameBench::setup(int level, int length) {
+    int cellsX = game.boardWidth / CELL_SIZE;
+    int cellsY = game.boardHeight / CELL_SIZE;
+
+    vector<Point> path;
+    for (int row = cellsY - 1, n = 0; row > cellsY / 2; --row, ++n) {
+        for (int i = 0; i < cellsX; ++i) {
+            int col = (n % 2 == 0) ? i : cellsX - 1 - i;
+            path.push_back({ col * CELL_SIZE, row * CELL_SIZE });
+        }
+    }
+    if (length < 1 || length >= static_cast<int>(path.size())) {
+        return false;
+    }
+
+    body.clear();
+    for (int i = length - 1; i >= 0; --i) {
+        body.push_back(path[i]);
+    }
+    nextHead = path[length];
+    Point head = path[length - 1];
+    if (nextHead.x > head.x) bodyDir = RIGHT;
+    else if (nextHead.x < head.x) bodyDir = LEFT;
+    else bodyDir = UP;
+
+    game.sim.level2 = level >= 2;
+    game.sim.level3 = level >= 3;
+    game.sim.snake.reserve(length + 1);
+    prepare();
+    return true;
+}
+
+void GameBench::prepare() {
+    game.reset();
+    game.sim.snake.assign(body);
+    game.sim.dir = bodyDir;
+    game.sim.food = { CELL_SIZE, CELL_SIZE };
+    game.sim.rebuild();
+}
+
+#ifdef SNAKE_ALLOC_TRACK
+
+const uint64_t ALLOC_CHECK_SEED = 1;
+
+// Plays the game loop headless with the snake circling a rectangle clear of the obstacle
+// and the enemies, and fails if anything is allocated once it has warmed up.
+bool GameBench::allocCheck(int level, int warmupTicks, int ticks) {
+    const int left = 2 * CELL_SIZE, right = 10 * CELL_SIZE, top = 2 * CELL_SIZE, bottom = 8 * CELL_SIZE;
+    game.sim.level2 = level >= 2;
+    game.sim.level3 = level >= 3;
+    game.reset(ALLOC_CHECK_SEED);//the same food every run, so whether a new score is drawn doesn't vary
+    game.sim.snake.clear();
+    for (int i = 0; i < 3; ++i) {
+        game.sim.snake.push_back({ left + (2 - i) * CELL_SIZE, top });
+    }
+    game.sim.rebuild();
+    game.sim.dir = RIGHT;
+
+    for (int tick = 0; tick < warmupTicks + ticks; ++tick) {
+        if (tick == warmupTicks) {
+            allocPhaseReset();
+        }
+
+        Point head = game.sim.snake[0];
+        if (head.y == top && head.x < right) game.sim.dir = RIGHT;
+        else if (head.x == right && head.y < bottom) game.sim.dir = DOWN;
+        else if (head.y == bottom && head.x > left) game.sim.dir = LEFT;
+        else game.sim.dir = UP;
+
+        game.handleEvents();
+        game.update();
+        game.render();
+        if (game.sim.gameOver) {
+            cout << "level " << level << ": snake died at tick " << tick << endl;
+            return false;
+        }
+    }
+
+    bool clean = true;
+    cout << "level " << level << ":";
+    for (int phase = ALLOC_EVENTS; phase < ALLOC_PHASE_COUNT; ++phase) {
+        AllocPhaseStats stats = allocPhaseStats(static_cast<AllocPhase>(phase));
+        cout << " " << allocPhaseName(static_cast<AllocPhase>(phase)) << " " << stats.count
+             << " allocs (" << stats.bytes << " bytes)";
+        clean = clean && stats.count == 0;
+    }
+    cout << (clean ? " OK" : " FAILED") << endl;
+    return clean;
+}
+
+static int allocCheck() {
+    GameOptions options;
+    options.headless = true;
+    options.seed = ALLOC_CHECK_SEED;
+    SnakeGame game(options);
+    if (!game.init()) {
+        cout << "Failed to initialize!" << endl;
+        return -1;
+    }
+
+    GameBench bench(game);
+    bool clean = true;
+    for (int level = 1; level <= 3; ++level) {
+        clean = bench.allocCheck(level, 200, 2000) && clean;
+    }
+    return clean ? 0 : 1;
+}
+
+#else
+
+static int allocCheck() {
+    cout << "Allocation tracking is not compiled in, build with 'make alloccheck'" << endl;
+    return 2;
+}
+
+#endif
+
+static Uint64 ticksToNs(Uint64 ticks) {
+    return ticks * 1000000000ull / SDL_GetPerformanceFrequency();
+}
+
+static vector<double> sample(int iterations, const function<void()>& before, const function<void()>& op) {
+    vector<double> samples;
+    samples.reserve(iterations);
+    for (int i = 0; i < iterations; ++i) {
+        if (before) {
+            before();
+        }
+        Uint64 start = SDL_GetPerformanceCounter();
+        op();
+        samples.push_back(static_cast<double>(ticksToNs(SDL_GetPerformanceCounter() - start)));
+    }
+    return samples;
+}
+
+static double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+static void writeJson(ostream& out, const vector<BenchResult>& results, int iterations, int renderIterations) {
+    out << "{\n  \"iterations\": " << iterations << ",\n  \"render_iterations\": " << renderIterations
+        << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        vector<double> sorted = r.samples;
+        sort(sorted.begin(), sorted.end());
+        double total = 0.0;
+        for (double v : sorted) {
+            total += v;
+        }
+
+        out << "    {\"name\": \"" << r.name << "\", \"level\": " << r.level
+            << ", \"board\": \"" << r.cellsX << "x" << r.cellsY << "\", \"length\": " << r.length
+            << ", \"samples\": " << sorted.size()
+            << ", \"mean_ns\": " << (sorted.empty() ? 0.0 : total / sorted.size())
+            << ", \"min_ns\": " << percentile(sorted, 0.0)
+            << ", \"p50_ns\": " << percentile(sorted, 0.50)
+            << ", \"p90_ns\": " << percentile(sorted, 0.90)
+            << ", \"p99_ns\": " << percentile(sorted, 0.99)
+            << ", \"max_ns\": " << percentile(sorted, 1.0) << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+// Snake bodies far longer than any board here, as Points and as a BodyChain: bytes per
+// segment and how fast each converts, plus the chain's own head push and tail pop
+static int benchBody() {
+    const size_t lengths[] = { 1000, 10000, 100000, 1000000 };
+    const int width = 1000;     // cells per serpentine row
+    for (size_t length : lengths) {
+        vector<Point> body;
+        body.reserve(length);
+        for (size_t i = 0; i < length; ++i) {
+            int row = static_cast<int>(i / width), col = static_cast<int>(i % width);
+            body.push_back({ (row % 2 == 0 ? col : width - 1 - col) * CELL_SIZE, row * CELL_SIZE });
+        }
+        reverse(body.begin(), body.end());//head first
+
+        vector<uint8_t> encoded;
+        encoded.reserve(length / 4 + 32);
+        Uint64 start = SDL_GetPerformanceCounter();
+        BodyChain::encode(body, encoded);
+        double encodeNs = static_cast<double>(ticksToNs(SDL_GetPerformanceCounter() - start));
+
+        vector<Point> decoded;
+        decoded.reserve(length);
+        size_t pos = 0;
+        start = SDL_GetPerformanceCounter();
+        BodyChain::decode(encoded.data(), encoded.size(), pos, decoded, length);
+        double decodeNs = static_cast<double>(ticksToNs(SDL_GetPerformanceCounter() - start));
+        if (decoded.size() != body.size() || !equal(decoded.begin(), decoded.end(), body.begin(),
+                [](const Point& a, const Point& b) { return a.x == b.x && a.y == b.y; })) {
+            cout << "length " << length << ": decoded body differs" << endl;
+            return 1;
+        }
+
+        BodyChain chain;
+        chain.assign(body);
+        const Direction turns[] = { RIGHT, DOWN, LEFT, UP };
+        start = SDL_GetPerformanceCounter();
+        for (size_t i = 0; i < length; ++i) {
+            chain.pushHead(turns[(i / 7) % 4]);
+            chain.popTail();
+        }
+        double moveNs = static_cast<double>(ticksToNs(SDL_GetPerformanceCounter() - start));
+
+        cout << "length " << length << ": points " << length * sizeof(Point) << " B, chain " << encoded.size()
+             << " B (" << encoded.size() * 8.0 / length << " bits/segment), encode "
+             << length / (encodeNs / 1e9) / 1e6 << " M segments/s, decode " << length / (decodeNs / 1e9) / 1e6
+             << " M segments/s, push+pop " << moveNs / length << " ns" << endl;
+    }
+    return 0;
+}
+
+int main(int argc, char* args[]) {
+    int iterations = 2000;
+    int renderIterations = 200;
+    string outPath = "bench_results.json";
+    for (int i = 1; i < argc; ++i) {
+        string arg = args[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = atoi(args[++i]);
+        } else if (arg == "--render-iterations" && i + 1 < argc) {
+            renderIterations = atoi(args[++i]);
+        } else if (arg == "--out" && i + 1 < argc) {
+            outPath = args[++i];
+        } else if (arg == "--alloc-check") {
+            return allocCheck();
+        } else if (arg == "--body") {
+            return benchBody();
+        }
+    }
+
+    const int boards[][2] = { { 32, 24 }, { 64, 48 }, { 128, 96 } };
+    const int lengths[] = { 4, 32, 256, 1024 };
+
+    vector<BenchResult> results;
+    for (const auto& board : boards) {
+        GameOptions options;
+        options.headless = true;
+        options.boardWidth = board[0] * CELL_SIZE;
+        options.boardHeight = board[1] * CELL_SIZE;
+
+        SnakeGame game(options);
+        if (!game.init()) {
+            cout << "Failed to initialize!" << endl;
+            return -1;
+        }
+        GameBench bench(game);
+
+        for (int level = 1; level <= 3; ++level) {
+            for (int length : lengths) {
+                if (!bench.setup(level, length)) {
+                    continue;
+                }
+                auto prepare = [&]() { bench.prepare(); };
+                auto add = [&](const char* name, vector<double> samples) {
+                    results.push_back({ name, level, board[0], board[1], length, samples });
+                };
+
+                add("update", sample(iterations, prepare, [&]() { bench.update(); }));
+                add("spawnFood", sample(iterations, prepare, [&]() { bench.spawnFood(); }));
+                add("checkCollision", sample(iterations, nullptr, [&]() {
+                    volatile bool hit = bench.checkCollision();
+                    (void)hit;
+                }));
+                bench.prepare();
+                add("saveSnapshot", sample(iterations, nullptr, [&]() { bench.saveSnapshot(); }));
+                add("loadSnapshot", sample(iterations, nullptr, [&]() { bench.loadSnapshot(); }));
+                bench.prepare();
+                add("render", sample(renderIterations, nullptr, [&]() { bench.render(); }));
+                add("renderText", sample(renderIterations, nullptr, [&]() { bench.renderText(); }));
+
+                cout << "board " << board[0] << "x" << board[1] << " level " << level
+                     << " length " << length << " done" << endl;
+            }
+        }
+    }
+
+    ofstream out(outPath.c_str());
+    if (!out) {
+        cout << "Failed to open " << outPath << endl;
+        return -1;
+    }
+    writeJson(out, results, iterations, renderIterations);
+    cout << "Wrote " << results.size() << " results to " << outPath << endl;
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include "bodychain.h"
+#include "varint.h"
+
+using namespace std;
+
+static const int STEP_X[4] = { 0, 0, -CELL_SIZE, CELL_SIZE };    // by Direction
+static const int STEP_Y[4] = { -CELL_SIZE, CELL_SIZE, 0, 0 };
+
+// The Direction from one cell to the next, or -1 if they are not neighbours
+static int direction(const Point& from, const Point& to) {
+    int dx = to.x - from.x, dy = to.y - from.y;
+    for (int dir = 0; dir < 4; ++dir) {
+        if (dx == STEP_X[dir] && dy == STEP_Y[dir]) {
+            return dir;
+        }
+    }
+    return -1;
+}
+
+BodyChain::BodyChain() : first(0), links(0), empty(true), headCell({ 0, 0 }), tailCell({ 0, 0 }) {}
+
+void BodyChain::clear() {
+    first = 0;
+    links = 0;
+    empty = true;
+}
+
+Direction BodyChain::link(size_t i) const {
+    size_t at = (first + i) & (words.size() * 32 - 1);//the ring is always a power of two
+    return static_cast<Direction>((words[at / 32] >> ((at % 32) * 2)) & 3);
+}
+
+// Doubles the ring and lays the links out from the start again, so pushHead() is O(1) amortized
+void BodyChain::grow() {
+    vector<uint64_t> larger(words.empty() ? 4 : words.size() * 2, 0);
+    for (size_t i = 0; i < links; ++i) {
+        larger[i / 32] |= static_cast<uint64_t>(link(i)) << ((i % 32) * 2);
+    }
+    words.swap(larger);
+    first = 0;
+}
+
+bool BodyChain::assign(const vector<Point>& body) {
+    clear();
+    if (body.empty()) {
+        return true;
+    }
+    headCell = tailCell = body.back();
+    empty = false;
+    for (size_t i = body.size() - 1; i > 0; --i) {
+        int dir = direction(body[i], body[i - 1]);
+        if (dir < 0) {
+            clear();
+            return false;
+        }
+        pushHead(static_cast<Direction>(dir));
+    }
+    return true;
+}
+
+void BodyChain::pushHead(Direction dir) {
+    if (empty) {
+        return;//nothing to grow from
+    }
+    if (links == words.size() * 32) {
+        grow();
+    }
+    size_t at = (first + links) & (words.size() * 32 - 1);
+    uint64_t& word = words[at / 32];
+    word = (word & ~(3ull << ((at % 32) * 2))) | (static_cast<uint64_t>(dir) << ((at % 32) * 2));
+    links++;
+    headCell.x += STEP_X[dir];
+    headCell.y += STEP_Y[dir];
+}
+
+void BodyChain::popTail() {
+    if (links == 0) {
+        clear();
+        return;
+    }
+    Direction dir = link(0);
+    tailCell.x += STEP_X[dir];
+    tailCell.y += STEP_Y[dir];
+    first = (first + 1) & (words.size() * 32 - 1);
+    links--;
+}
+
+void BodyChain::decode(vector<Point>& body) const {
+    body.resize(size());
+    if (empty) {
+        return;
+    }
+    Point cell = headCell;
+    body[0] = cell;
+    for (size_t i = 0; i < links; ++i) {
+        Direction dir = link(links - 1 - i);
+        cell.x -= STEP_X[dir];
+        cell.y -= STEP_Y[dir];
+        body[i + 1] = cell;
+    }
+}
+
+void BodyChain::write(vector<uint8_t>& out) const {
+    putVarint(out, zigzag(headCell.x));
+    putVarint(out, zigzag(headCell.y));
+    putVarint(out, size());
+    size_t start = out.size();
+    out.resize(start + (links + 3) / 4, 0);
+    for (size_t i = 0; i < links; ++i) {
+        out[start + i / 4] |= static_cast<uint8_t>(link(links - 1 - i) << ((i % 4) * 2));
+    }
+}
+
+// Straight from the Points, without building a ring, for saveState()
+template <typename Points>
+static bool encodePoints(const Points& body, vector<uint8_t>& out) {
+    size_t mark = out.size();
+    Point head = body.empty() ? Point{ 0, 0 } : body[0];
+    putVarint(out, zigzag(head.x));
+    putVarint(out, zigzag(head.y));
+    putVarint(out, body.size());
+    size_t start = out.size();
+    size_t count = body.empty() ? 0 : body.size() - 1;
+    out.resize(start + (count + 3) / 4, 0);
+    for (size_t i = 0; i < count; ++i) {
+        int dir = direction(body[i + 1], body[i]);
+        if (dir < 0) {
+            out.resize(mark);
+            return false;
+        }
+        out[start + i / 4] |= static_cast<uint8_t>(dir << ((i % 4) * 2));
+    }
+    return true;
+}
+
+bool BodyChain::encode(const vector<Point>& body, vector<uint8_t>& out) {
+    return encodePoints(body, out);
+}
+
+bool BodyChain::encode(const SnakeBody& body, vector<uint8_t>& out) {
+    return encodePoints(body, out);
+}
+
+bool BodyChain::decode(const uint8_t* data, size_t size, size_t& pos, vector<Point>& body, size_t limit) {
+    uint64_t x, y, count;
+    if (!getVarint(data, size, pos, x) || !getVarint(data, size, pos, y) || !getVarint(data, size, pos, count)
+        || count > limit) {
+        return false;
+    }
+    size_t packed = count > 0 ? (static_cast<size_t>(count) + 2) / 4 : 0;
+    if (packed > size - pos) {
+        return false;
+    }
+    body.resize(static_cast<size_t>(count));
+    if (count == 0) {
+        return true;
+    }
+    Point cell = { static_cast<int>(unzigzag(x)), static_cast<int>(unzigzag(y)) };
+    body[0] = cell;
+    for (size_t i = 1; i < count; ++i) {
+        int dir = (data[pos + (i - 1) / 4] >> (((i - 1) % 4) * 2)) & 3;
+        cell.x -= STEP_X[dir];
+        cell.y -= STEP_Y[dir];
+        body[i] = cell;
+    }
+    pos += packed;
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef BODYCHAIN_H
+#define BODYCHAIN_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A snake body as its head cell and a 2-bit Direction per link between neighbouring
+// segments: a quarter byte per segment instead of the 8 bytes of a Point. Snapshots,
+// replay keyframes and anything sent over a network store the snake this way.
+//
+//   varint zigzag head x and y (pixels), varint segment count, then the links from the
+//   head back to the tail, four to a byte starting at the low bits. A link is the
+//   Direction from the segment behind to the segment in front of it.
+//
+// BodyChain keeps a body in that form as a ring, for code that wants to grow it at the
+// head and drop the tail without ever holding the Points.
+
+class BodyChain {
+public:
+    BodyChain();
+    void clear();
+    bool assign(const std::vector<Point>& body);    // false unless every segment is next to the one before
+    void pushHead(Direction dir);                   // a new head one cell from the old one
+    void popTail();
+    size_t size() const { return links + (empty ? 0 : 1); }
+    Point head() const { return headCell; }
+    Point tail() const { return tailCell; }
+    void decode(std::vector<Point>& body) const;    // head first, like Simulation::snake
+    void write(std::vector<uint8_t>& out) const;    // appends
+    size_t bytes() const { return words.capacity() * sizeof(uint64_t); }
+
+    static bool encode(const std::vector<Point>& body, std::vector<uint8_t>& out);  // appends
+    static bool encode(const SnakeBody& body, std::vector<uint8_t>& out);
+    static bool decode(const uint8_t* data, size_t size, size_t& pos, std::vector<Point>& body, size_t limit);
+
+private:
+    Direction link(size_t i) const;                 // i = 0 is the link at the tail
+    void grow();
+
+    std::vector<uint64_t> words;                    // ring of links, 32 to a word
+    size_t first;                                   // ring position of the tail's link
+    size_t links;
+    bool empty;
+    Point headCell;
+    Point tailCell;
+};
+
+#endif
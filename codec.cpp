@@ -0,0 +1,505 @@
+#include "codec.h"
+#include "simulation.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+using namespace std;
+
+const int PROB_BITS = 11;
+const uint16_t PROB_HALF = 1 << (PROB_BITS - 1);
+const int PROB_SHIFT = 5;       // adaptation rate
+const uint32_t RANGE_TOP = 1u << 24;
+const int GAP_CONTEXTS = 8;
+const int TIMING_CONTEXTS = 12;
+
+// Carry-propagating range encoder: low can overflow into bit 32, which is added to the
+// pending 0xFF bytes when they are finally written
+class RangeEncoder {
+public:
+    RangeEncoder(vector<uint8_t>& out) : out(out), low(0), range(0xFFFFFFFFu), cache(0), cacheSize(1) {}
+
+    void bit(uint16_t& prob, int value) {
+        uint32_t bound = (range >> PROB_BITS) * prob;
+        if (value == 0) {
+            range = bound;
+            prob += ((1 << PROB_BITS) - prob) >> PROB_SHIFT;
+        } else {
+            low += bound;
+            range -= bound;
+            prob -= prob >> PROB_SHIFT;
+        }
+        normalize();
+    }
+
+    // Equiprobable bits, for the seed
+    void direct(uint64_t value, int bits) {
+        for (int i = bits - 1; i >= 0; --i) {
+            range >>= 1;
+            if ((value >> i) & 1) {
+                low += range;
+            }
+            normalize();
+        }
+    }
+
+    void finish() {
+        for (int i = 0; i < 5; ++i) {
+            shiftLow();
+        }
+    }
+
+private:
+    void normalize() {
+        while (range < RANGE_TOP) {
+            range <<= 8;
+            shiftLow();
+        }
+    }
+
+    void shiftLow() {
+        if (static_cast<uint32_t>(low) < 0xFF000000u || (low >> 32) != 0) {
+            uint8_t carry = static_cast<uint8_t>(low >> 32);
+            uint8_t byte = cache;
+            do {
+                out.push_back(static_cast<uint8_t>(byte + carry));
+                byte = 0xFF;
+            } while (--cacheSize != 0);
+            cache = static_cast<uint8_t>(low >> 24);
+        }
+        cacheSize++;
+        low = (low & 0x00FFFFFFu) << 8;
+    }
+
+    vector<uint8_t>& out;
+    uint64_t low;
+    uint32_t range;
+    uint8_t cache;
+    uint64_t cacheSize;
+};
+
+// Reads zeros past the end and counts them, so a truncated stream is caught by overrun()
+class RangeDecoder {
+public:
+    RangeDecoder(const uint8_t* data, size_t size) : data(data), size(size), pos(0), range(0xFFFFFFFFu), code(0) {
+        for (int i = 0; i < 5; ++i) {
+            code = (code << 8) | next();
+        }
+    }
+
+    int bit(uint16_t& prob) {
+        uint32_t bound = (range >> PROB_BITS) * prob;
+        int value;
+        if (code < bound) {
+            range = bound;
+            prob += ((1 << PROB_BITS) - prob) >> PROB_SHIFT;
+            value = 0;
+        } else {
+            code -= bound;
+            range -= bound;
+            prob -= prob >> PROB_SHIFT;
+            value = 1;
+        }
+        normalize();
+        return value;
+    }
+
+    uint64_t direct(int bits) {
+        uint64_t value = 0;
+        for (int i = 0; i < bits; ++i) {
+            range >>= 1;
+            int b = code >= range ? 1 : 0;
+            if (b) {
+                code -= range;
+            }
+            value = (value << 1) | b;
+            normalize();
+        }
+        return value;
+    }
+
+    bool overrun() const { return pos > size + 4; }//the encoder's flush pads 4 bytes at most
+    size_t consumed() const { return pos; }
+
+private:
+    uint8_t next() { return pos < size ? data[pos++] : (pos++, 0); }
+
+    void normalize() {
+        while (range < RANGE_TOP) {
+            range <<= 8;
+            code = (code << 8) | next();
+        }
+    }
+
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    uint32_t range;
+    uint32_t code;
+};
+
+// Non-negative integers up to 32 bits: the bit length of value + 1 through a 6-level bit
+// tree, then its top three mantissa bits through a tree per length and the rest raw-ish
+struct IntModel {
+    uint16_t length[64];
+    uint16_t mantissa[34][8];
+    uint16_t low[32];
+
+    IntModel() {
+        fill(&length[0], &length[0] + 64, PROB_HALF);
+        fill(&mantissa[0][0], &mantissa[0][0] + 34 * 8, PROB_HALF);
+        fill(&low[0], &low[0] + 32, PROB_HALF);
+    }
+
+    void encode(RangeEncoder& coder, uint32_t value) {
+        uint64_t v = static_cast<uint64_t>(value) + 1;
+        int bits = 64 - __builtin_clzll(v);
+        int node = 1;
+        for (int i = 5; i >= 0; --i) {
+            int b = ((bits - 1) >> i) & 1;
+            coder.bit(length[node], b);
+            node = node * 2 + b;
+        }
+        node = 1;
+        for (int i = bits - 2; i >= 0; --i) {
+            int b = (v >> i) & 1;
+            if (i >= bits - 4) {
+                coder.bit(mantissa[bits][node], b);
+                node = node * 2 + b;
+            } else {
+                coder.bit(low[i], b);
+            }
+        }
+    }
+
+    uint32_t decode(RangeDecoder& coder) {
+        int node = 1;
+        for (int i = 0; i < 6; ++i) {
+            node = node * 2 + coder.bit(length[node]);
+        }
+        int bits = node - 64 + 1;
+        if (bits > 33) {
+            return 0;
+        }
+        uint64_t v = 1;
+        node = 1;
+        for (int i = bits - 2; i >= 0; --i) {
+            int b;
+            if (i >= bits - 4) {
+                b = coder.bit(mantissa[bits][node]);
+                node = node * 2 + b;
+            } else {
+                b = coder.bit(low[i]);
+            }
+            v = (v << 1) | b;
+        }
+        return static_cast<uint32_t>(v - 1);
+    }
+};
+
+static int bitLength(uint32_t value) {
+    return value == 0 ? 0 : 32 - __builtin_clz(value);
+}
+
+// How a direction change turns relative to the previous direction
+enum Turn { TURN_NONE, TURN_LEFT, TURN_RIGHT, TURN_REVERSE };
+
+static const uint8_t TURN_TO[4][4] = {
+    // by previous Direction then Turn: the new Direction
+    { UP, LEFT, RIGHT, DOWN },      // UP
+    { DOWN, RIGHT, LEFT, UP },      // DOWN
+    { LEFT, DOWN, UP, RIGHT },      // LEFT
+    { RIGHT, UP, DOWN, LEFT },      // RIGHT
+};
+
+static int turnOf(int from, int to) {
+    for (int turn = 0; turn < 4; ++turn) {
+        if (TURN_TO[from][turn] == to) {
+            return turn;
+        }
+    }
+    return TURN_NONE;
+}
+
+struct ReplayModel {
+    uint16_t turns[16][4];          // 2-bit tree, by the previous two turns
+    IntModel gaps[GAP_CONTEXTS];    // by the previous gap's length
+    IntModel misc;
+    uint16_t flags[4];
+    IntModel hashGaps;              // ticks since the previous hash
+    IntModel keyframeGaps;
+    IntModel stateSizes;
+    uint16_t stateBytes[256][256];  // 8-bit tree, by the previous byte
+
+    ReplayModel() {
+        fill(&turns[0][0], &turns[0][0] + 16 * 4, PROB_HALF);
+        fill(&flags[0], &flags[0] + 4, PROB_HALF);
+        fill(&stateBytes[0][0], &stateBytes[0][0] + 256 * 256, PROB_HALF);
+    }
+};
+
+static int gapContext(uint32_t gap) {
+    return min(bitLength(gap), GAP_CONTEXTS - 1);
+}
+
+// Hashes and keyframes after the end record: hashes are random, so only their ticks
+// compress; keyframe states through an order-1 byte model
+static void encodeCheckpoints(RangeEncoder& coder, ReplayModel& model, const Replay& replay) {
+    model.misc.encode(coder, static_cast<uint32_t>(replay.hashes.size()));
+    uint32_t last = 0;
+    for (const auto& hash : replay.hashes) {
+        model.hashGaps.encode(coder, hash.tick - last);
+        last = hash.tick;
+        coder.direct(hash.hash, 64);
+    }
+    model.misc.encode(coder, static_cast<uint32_t>(replay.keyframes.size()));
+    last = 0;
+    for (const auto& keyframe : replay.keyframes) {
+        model.keyframeGaps.encode(coder, keyframe.tick - last);
+        last = keyframe.tick;
+        model.stateSizes.encode(coder, static_cast<uint32_t>(keyframe.state.size()));
+        uint8_t previous = 0;
+        for (uint8_t byte : keyframe.state) {
+            int node = 1;
+            for (int b = 7; b >= 0; --b) {
+                int value = (byte >> b) & 1;
+                coder.bit(model.stateBytes[previous][node], value);
+                node = node * 2 + value;
+            }
+            previous = byte;
+        }
+    }
+}
+
+static bool decodeCheckpoints(RangeDecoder& coder, ReplayModel& model, size_t size, Replay& replay) {
+    uint32_t count = model.misc.decode(coder);
+    if (count > size) {//every hash takes 8 bytes
+        return false;
+    }
+    replay.hashes.reserve(count);
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < count && !coder.overrun(); ++i) {
+        last += model.hashGaps.decode(coder);
+        replay.hashes.push_back({ last, coder.direct(64) });
+    }
+    count = model.misc.decode(coder);
+    if (count > (size + 16) * 8) {
+        return false;
+    }
+    replay.keyframes.reserve(count);
+    last = 0;
+    for (uint32_t i = 0; i < count && !coder.overrun(); ++i) {
+        last += model.keyframeGaps.decode(coder);
+        uint32_t length = model.stateSizes.decode(coder);
+        if (length > (size + 16) * 64) {//a byte takes 1/8 bit at best
+            return false;
+        }
+        ReplayKeyframe keyframe;
+        keyframe.tick = last;
+        keyframe.state.resize(length);
+        uint8_t previous = 0;
+        for (uint32_t j = 0; j < length; ++j) {
+            int node = 1;
+            for (int b = 0; b < 8; ++b) {
+                node = node * 2 + coder.bit(model.stateBytes[previous][node]);
+            }
+            keyframe.state[j] = previous = static_cast<uint8_t>(node - 256);
+        }
+        replay.keyframes.push_back(move(keyframe));
+    }
+    return true;
+}
+
+void compressReplay(const Replay& replay, vector<uint8_t>& out) {
+    out.push_back(CODEC_VERSION);
+    RangeEncoder coder(out);
+    auto model = make_unique<ReplayModel>();//over 128 KB, kept off the stack
+    const ReplayHeader& header = replay.header;
+    model->misc.encode(coder, header.level);
+    model->misc.encode(coder, header.boardWidth / CELL_SIZE);
+    model->misc.encode(coder, header.boardHeight / CELL_SIZE);
+    coder.direct(header.seed, 64);
+    model->misc.encode(coder, static_cast<uint32_t>(replay.inputs.size()));
+
+    uint32_t last = 0;      // tick of the previous change + 1, as in the file format
+    int dir = UP;
+    int history = 0;
+    int gapCtx = 0;
+    for (const auto& input : replay.inputs) {
+        uint32_t gap = input.tick + 1 - last;
+        model->gaps[gapCtx].encode(coder, gap);
+        gapCtx = gapContext(gap);
+        last = input.tick + 1;
+
+        int turn = turnOf(dir, input.dir & 3);
+        coder.bit(model->turns[history][1], turn >> 1);
+        coder.bit(model->turns[history][2 + (turn >> 1)], turn & 1);
+        history = ((history << 2) | turn) & 15;
+        dir = input.dir & 3;
+    }
+
+    coder.bit(model->flags[0], replay.complete ? 1 : 0);
+    if (replay.complete) {
+        model->misc.encode(coder, replay.ticks - min(replay.ticks, last));
+        bool tens = replay.score % 10 == 0;//the game scores in tens
+        coder.bit(model->flags[1], tens ? 1 : 0);
+        model->misc.encode(coder, static_cast<uint32_t>(tens ? replay.score / 10 : replay.score));
+        coder.bit(model->flags[2], replay.died ? 1 : 0);
+    }
+    encodeCheckpoints(coder, *model, replay);
+    coder.finish();
+}
+
+bool decompressReplay(const uint8_t* data, size_t size, Replay& replay) {
+    if (size < 1 || data[0] < 1 || data[0] > CODEC_VERSION) {
+        return false;
+    }
+    RangeDecoder coder(data + 1, size - 1);
+    auto model = make_unique<ReplayModel>();
+    ReplayHeader& header = replay.header;
+    memcpy(header.magic, "SNRP", 4);
+    header.version = REPLAY_VERSION;
+    header.level = static_cast<uint8_t>(model->misc.decode(coder));
+    header.reserved = 0;
+    header.boardWidth = static_cast<uint16_t>(model->misc.decode(coder) * CELL_SIZE);
+    header.boardHeight = static_cast<uint16_t>(model->misc.decode(coder) * CELL_SIZE);
+    header.seed = coder.direct(64);
+    uint32_t count = model->misc.decode(coder);
+    if (count > (size + 16) * 8) {//every input takes some fraction of a bit at least
+        return false;
+    }
+
+    replay.inputs.clear();
+    replay.keyframes.clear();
+    replay.hashes.clear();
+    replay.inputs.reserve(count);
+    uint32_t last = 0;
+    int dir = UP;
+    int history = 0;
+    int gapCtx = 0;
+    for (uint32_t i = 0; i < count && !coder.overrun(); ++i) {
+        uint32_t gap = model->gaps[gapCtx].decode(coder);
+        gapCtx = gapContext(gap);
+        last += gap;
+
+        int high = coder.bit(model->turns[history][1]);
+        int turn = (high << 1) | coder.bit(model->turns[history][2 + high]);
+        history = ((history << 2) | turn) & 15;
+        dir = TURN_TO[dir][turn];
+        replay.inputs.push_back({ last - 1, static_cast<uint8_t>(dir) });
+    }
+
+    replay.complete = coder.bit(model->flags[0]) != 0;
+    replay.ticks = replay.inputs.empty() ? 0 : replay.inputs.back().tick + 1;
+    replay.score = 0;
+    replay.died = false;
+    if (replay.complete) {
+        replay.ticks = last + model->misc.decode(coder);
+        bool tens = coder.bit(model->flags[1]) != 0;
+        replay.score = static_cast<int>(model->misc.decode(coder) * (tens ? 10u : 1u));
+        replay.died = coder.bit(model->flags[2]) != 0;
+    }
+    if (data[0] >= CODEC_CHECKPOINT_VERSION && !decodeCheckpoints(coder, *model, size, replay)) {
+        return false;
+    }
+    return !coder.overrun();
+}
+
+struct TickModel {
+    IntModel tickGaps;
+    IntModel timings[4][TIMING_CONTEXTS];   // eventsUs, updateUs, renderUs, totalUs
+    uint16_t events[16][32];                // bit tree per event bit, by the previous record's bits
+    IntModel length;
+    IntModel score;
+    IntModel header;
+
+    TickModel() {
+        fill(&events[0][0], &events[0][0] + 16 * 32, PROB_HALF);
+    }
+};
+
+static uint32_t zigzag32(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static int32_t unzigzag32(uint32_t value) {
+    return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1)));
+}
+
+void compressTicks(const FlightHeader& header, const TickRecord* records, vector<uint8_t>& out) {
+    out.push_back(CODEC_VERSION);
+    RangeEncoder coder(out);
+    auto model = make_unique<TickModel>();
+    model->header.encode(coder, header.version);
+    model->header.encode(coder, header.count);
+    model->header.encode(coder, header.budgetUs);
+    model->header.encode(coder, header.reason);
+    model->header.encode(coder, header.triggerTick);
+
+    TickRecord previous;
+    memset(&previous, 0, sizeof(previous));
+    for (uint32_t i = 0; i < header.count; ++i) {
+        const TickRecord& r = records[i];
+        model->tickGaps.encode(coder, zigzag32(static_cast<int32_t>(r.tick - previous.tick)));
+        const uint32_t timings[4] = { r.eventsUs, r.updateUs, r.renderUs, r.totalUs };
+        const uint32_t before[4] = { previous.eventsUs, previous.updateUs, previous.renderUs, previous.totalUs };
+        for (int f = 0; f < 4; ++f) {
+            model->timings[f][min(bitLength(before[f]), TIMING_CONTEXTS - 1)].encode(coder, timings[f]);
+        }
+        int node = 1;
+        for (int b = 4; b >= 0; --b) {
+            int value = (r.events >> b) & 1;
+            coder.bit(model->events[previous.events & 15][node], value);
+            node = node * 2 + value;
+        }
+        model->length.encode(coder, zigzag32(r.snakeLength - previous.snakeLength));
+        model->score.encode(coder, zigzag32(static_cast<int32_t>(static_cast<uint32_t>(r.score) - previous.score)));
+        previous = r;
+    }
+    coder.finish();
+}
+
+bool decompressTicks(const uint8_t* data, size_t size, FlightHeader& header, vector<TickRecord>& records) {
+    if (size < 1 || data[0] < 1 || data[0] > CODEC_VERSION) {
+        return false;
+    }
+    RangeDecoder coder(data + 1, size - 1);
+    auto model = make_unique<TickModel>();
+    memcpy(header.magic, "SNFR", 4);
+    header.version = static_cast<uint16_t>(model->header.decode(coder));
+    header.recordSize = sizeof(TickRecord);
+    header.count = model->header.decode(coder);
+    header.budgetUs = model->header.decode(coder);
+    header.reason = model->header.decode(coder);
+    header.triggerTick = model->header.decode(coder);
+    if (header.count > FLIGHT_RECORDER_SIZE * 64) {
+        return false;
+    }
+
+    records.clear();
+    TickRecord previous;
+    memset(&previous, 0, sizeof(previous));
+    for (uint32_t i = 0; i < header.count && !coder.overrun(); ++i) {
+        TickRecord r;
+        r.tick = previous.tick + unzigzag32(model->tickGaps.decode(coder));
+        const uint32_t before[4] = { previous.eventsUs, previous.updateUs, previous.renderUs, previous.totalUs };
+        uint32_t timings[4];
+        for (int f = 0; f < 4; ++f) {
+            timings[f] = model->timings[f][min(bitLength(before[f]), TIMING_CONTEXTS - 1)].decode(coder);
+        }
+        r.eventsUs = timings[0];
+        r.updateUs = timings[1];
+        r.renderUs = timings[2];
+        r.totalUs = timings[3];
+        int node = 1;
+        for (int b = 0; b < 5; ++b) {
+            node = node * 2 + coder.bit(model->events[previous.events & 15][node]);
+        }
+        r.events = static_cast<uint16_t>(node - 32);
+        r.snakeLength = static_cast<uint16_t>(previous.snakeLength + unzigzag32(model->length.decode(coder)));
+        r.score = static_cast<int32_t>(previous.score + static_cast<uint32_t>(unzigzag32(model->score.decode(coder))));
+        records.push_back(r);
+        previous = r;
+    }
+    return !coder.overrun();
+}
@@ -0,0 +1,35 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include "replay.h"
+#include "watchdog.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Entropy coding for archiving replays and flight recorder dumps. An adaptive binary
+// range coder (LZMA style: 11-bit probabilities, carry-propagating byte output) codes
+// every field with a context model:
+//
+//   replays   a direction change is coded as a turn (left, right, reverse) relative to the
+//             previous direction, in the context of the previous two turns; the tick gap
+//             to it as an Elias-gamma style length and mantissa in the context of the
+//             previous gap's length. The seed and state hashes are stored raw;
+//             keyframe states go through an order-1 model of their bytes.
+//   ticks     TickRecords field by field, counters as deltas from the previous record
+//             and timings in the context of the previous timing's magnitude.
+//
+// A compressed replay keeps everything the file had, keyframes and hashes included: they
+// are what diverge and verify check a build against, so re-simulating can't stand in for
+// them. Version 1 archives have neither; flight dumps are coded the same in both.
+
+const uint8_t CODEC_VERSION = 2;
+const uint8_t CODEC_CHECKPOINT_VERSION = 2;
+
+void compressReplay(const Replay& replay, std::vector<uint8_t>& out);   // appends
+bool decompressReplay(const uint8_t* data, size_t size, Replay& replay);
+
+void compressTicks(const FlightHeader& header, const TickRecord* records, std::vector<uint8_t>& out);
+bool decompressTicks(const uint8_t* data, size_t size, FlightHeader& header, std::vector<TickRecord>& records);
+
+#endif
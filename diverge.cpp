@@ -0,0 +1,394 @@
+#include "simulation.h"
+#include "replay.h"
+#include "log.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+using namespace std;
+
+// Finds the first tick at which two runs of a game disagree, e.g. the replays two
+// clients or two builds recorded of the same match. The state hashes and keyframes the
+// replays recorded (--hashes N, --keyframes N) are the only evidence of the builds that
+// recorded them, so it starts from those:
+//
+//   - each replay against this build: re-simulated and compared at every recorded
+//     checkpoint, which shows whether the build that recorded it ran the same rules
+//   - the two recordings against each other at the ticks both checkpointed
+//
+// Where a recording and this build disagree, the builds diverge between the last
+// checkpoint that matched and the first that did not; that is as close as the evidence
+// goes, and a keyframe there is printed next to this build's state. Where this build
+// reproduces both recordings, they can only differ by input, seed or level, and both are
+// re-simulated side by side and bisected down to the single tick, with both states at
+// that tick printed side by side.
+//
+//   diverge [--interval N] a.snr b.snr
+
+const uint32_t DEFAULT_INTERVAL = 1024;
+const uint32_t NONE = UINT32_MAX;
+
+struct Side {
+    const Replay* replay;
+    Simulation sim;
+    size_t next;
+
+    Side(const Replay& replay) : replay(&replay), sim(replay.header.boardWidth, replay.header.boardHeight), next(0) {}
+};
+
+struct Checkpoint {
+    uint32_t tick;
+    vector<uint8_t> state[2];
+    size_t next[2];
+};
+
+// What a replay recorded of the state before a tick's input: its hash, and the whole
+// state if there is a keyframe at that tick
+struct Recorded {
+    uint32_t tick;
+    uint64_t hash;
+    const ReplayKeyframe* keyframe;
+};
+
+// Where the evidence stops agreeing: the last checkpoint that matched and the first that
+// did not, NONE if there was none
+struct Agreement {
+    uint32_t good;
+    uint32_t bad;
+    size_t compared;
+};
+
+static bool same(const Side& a, const Side& b) {
+    return a.sim.tick == b.sim.tick && a.sim.gameOver == b.sim.gameOver && a.sim.stateHash() == b.sim.stateHash();
+}
+
+static void save(Checkpoint& checkpoint, Side* sides) {
+    checkpoint.tick = sides[0].sim.tick;
+    for (int i = 0; i < 2; ++i) {
+        checkpoint.state[i].clear();
+        sides[i].sim.saveState(checkpoint.state[i]);
+        checkpoint.next[i] = sides[i].next;
+    }
+}
+
+static void restore(const Checkpoint& checkpoint, Side* sides) {
+    for (int i = 0; i < 2; ++i) {
+        sides[i].sim.loadState(checkpoint.state[i].data(), checkpoint.state[i].size());
+        sides[i].next = checkpoint.next[i];
+    }
+}
+
+// The hashes and keyframes in tick order. A keyframe's hash is taken from its state,
+// unless a recorded hash for the same tick says what the recording build made of it.
+static vector<Recorded> recorded(const Replay& replay) {
+    vector<Recorded> checkpoints;
+    Simulation state(replay.header.boardWidth, replay.header.boardHeight);
+    size_t h = 0, k = 0;
+    while (h < replay.hashes.size() || k < replay.keyframes.size()) {
+        bool hashFirst = k == replay.keyframes.size()
+                         || (h < replay.hashes.size() && replay.hashes[h].tick <= replay.keyframes[k].tick);
+        bool keyFirst = h == replay.hashes.size()
+                        || (k < replay.keyframes.size() && replay.keyframes[k].tick <= replay.hashes[h].tick);
+        Recorded checkpoint = { hashFirst ? replay.hashes[h].tick : replay.keyframes[k].tick, 0, nullptr };
+        if (keyFirst) {
+            const ReplayKeyframe& keyframe = replay.keyframes[k++];
+            if (state.loadState(keyframe.state.data(), keyframe.state.size())) {
+                checkpoint.keyframe = &keyframe;
+                checkpoint.hash = state.stateHash();
+            }
+        }
+        if (hashFirst) {
+            checkpoint.hash = replay.hashes[h++].hash;
+        } else if (checkpoint.keyframe == nullptr) {
+            continue;//a keyframe this build can't read
+        }
+        checkpoints.push_back(checkpoint);
+    }
+    return checkpoints;
+}
+
+// This build against what the build that recorded the replay saw
+static Agreement resimulate(const Replay& replay, const vector<Recorded>& checkpoints, Simulation& sim,
+                            uint64_t& simulated) {
+    Agreement agreement = { NONE, NONE, 0 };
+    sim.setLevel(replay.header.level);
+    sim.reset(replay.header.seed);
+    size_t next = 0;
+    for (const auto& checkpoint : checkpoints) {
+        uint32_t from = sim.tick;
+        replayAdvance(replay, sim, checkpoint.tick, next);
+        simulated += sim.tick - from;
+        agreement.compared++;
+        if (sim.tick != checkpoint.tick || sim.stateHash() != checkpoint.hash) {
+            agreement.bad = checkpoint.tick;
+            break;
+        }
+        agreement.good = checkpoint.tick;
+    }
+    return agreement;
+}
+
+// The two recordings against each other, at the ticks both have a checkpoint for
+static Agreement compareRecorded(const vector<Recorded>& a, const vector<Recorded>& b) {
+    Agreement agreement = { NONE, NONE, 0 };
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i].tick != b[j].tick) {
+            a[i].tick < b[j].tick ? ++i : ++j;
+            continue;
+        }
+        agreement.compared++;
+        if (a[i].hash != b[j].hash) {
+            agreement.bad = a[i].tick;
+            break;
+        }
+        agreement.good = a[i].tick;
+        ++i, ++j;
+    }
+    return agreement;
+}
+
+static const ReplayKeyframe* keyframeFrom(const vector<Recorded>& checkpoints, uint32_t tick) {
+    for (const auto& checkpoint : checkpoints) {
+        if (checkpoint.tick >= tick && checkpoint.keyframe != nullptr) {
+            return checkpoint.keyframe;
+        }
+    }
+    return nullptr;
+}
+
+static string tickText(uint32_t tick) {
+    return tick == NONE ? "the start" : "tick " + to_string(tick);
+}
+
+static string cell(const Point& p) {
+    return "(" + to_string(p.x / CELL_SIZE) + "," + to_string(p.y / CELL_SIZE) + ")";
+}
+
+template <typename Points>
+static string body(const Points& points) {
+    string text = to_string(points.size()) + " long";
+    if (!points.empty()) {
+        text += ", head " + cell(points.front()) + " tail " + cell(points.back());
+    }
+    return text;
+}
+
+static void row(const char* name, const string& a, const string& b) {
+    cout << (a != b ? "* " : "  ") << left << setw(10) << name << setw(36) << a << b << endl;
+}
+
+static string input(const Replay& replay, uint32_t tick) {
+    const char* names[] = { "UP", "DOWN", "LEFT", "RIGHT" };
+    string found = "-";
+    for (const auto& in : replay.inputs) {
+        if (in.tick == tick) {
+            found = names[in.dir & 3];//the last one of the tick is the one that counts
+        }
+    }
+    return found;
+}
+
+static void dump(const string& nameA, const Simulation& x, const Replay& a, const string& nameB, const Simulation& y,
+                 const Replay& b) {
+    auto hexText = [](uint64_t value) {
+        ostringstream out;
+        out << hex << setw(16) << setfill('0') << value;
+        return out.str();
+    };
+    cout << "  " << left << setw(10) << "" << setw(36) << nameA << nameB << endl;
+    row("tick", to_string(x.tick), to_string(y.tick));
+    row("input", input(a, x.tick - 1), input(b, y.tick - 1));
+    row("hash", hexText(x.stateHash()), hexText(y.stateHash()));
+    row("score", to_string(x.score), to_string(y.score));
+    row("gameOver", to_string(x.gameOver), to_string(y.gameOver));
+    row("dir", to_string(x.dir), to_string(y.dir));
+    row("food", cell(x.food), cell(y.food));
+    row("rng", hexText(x.rng.getState()), hexText(y.rng.getState()));
+    row("snake", body(x.snake), body(y.snake));
+    size_t common = min(x.snake.size(), y.snake.size());
+    for (size_t i = 0; i < common; ++i) {
+        if (x.snake[i].x != y.snake[i].x || x.snake[i].y != y.snake[i].y) {
+            row(("segment " + to_string(i)).c_str(), cell(x.snake[i]), cell(y.snake[i]));
+            break;
+        }
+    }
+    row("enemy1", body(x.enemy1), body(y.enemy1));
+    row("enemy2", body(x.enemy2), body(y.enemy2));
+    row("dir2/dir3", to_string(x.dir2) + "/" + to_string(x.dir3), to_string(y.dir2) + "/" + to_string(y.dir3));
+}
+
+// The recording build and this one ran different rules: the checkpoints bound where, and
+// the first keyframe from there on shows what differs
+static void reportBuild(const string& path, const Replay& replay, const vector<Recorded>& checkpoints,
+                        const Agreement& agreement) {
+    cout << path << ": the build that recorded it and this build diverge after " << tickText(agreement.good)
+         << ", by tick " << agreement.bad << endl;
+    if (agreement.good == NONE || agreement.bad - agreement.good > 1) {
+        cout << "  (record with --hashes 1 to narrow it to one tick)" << endl;
+    }
+    const ReplayKeyframe* keyframe = keyframeFrom(checkpoints, agreement.bad);
+    if (keyframe == nullptr) {
+        cout << "  (no keyframe from tick " << agreement.bad << " on to compare states, record with --keyframes N)" << endl;
+        return;
+    }
+    Simulation recordedState(replay.header.boardWidth, replay.header.boardHeight);
+    recordedState.loadState(keyframe->state.data(), keyframe->state.size());
+    Simulation sim(replay.header.boardWidth, replay.header.boardHeight);
+    sim.setLevel(replay.header.level);
+    sim.reset(replay.header.seed);
+    size_t next = 0;
+    replayAdvance(replay, sim, keyframe->tick, next);
+    dump("recorded", recordedState, replay, "this build", sim, replay);
+}
+
+static void describe(const string& path, const Replay& replay, const vector<Recorded>& checkpoints,
+                     const Agreement& agreement) {
+    cout << path << ": " << replay.hashes.size() << " hashes and " << replay.keyframes.size() << " keyframes";
+    if (checkpoints.empty()) {
+        cout << ", nothing to check the recording build against" << endl;
+    } else if (agreement.bad == NONE) {
+        cout << ", this build reproduces all " << agreement.compared << endl;
+    } else {
+        cout << ", this build matches through " << tickText(agreement.good) << " but not tick " << agreement.bad << endl;
+    }
+}
+
+int main(int argc, char* args[]) {
+    uint32_t interval = DEFAULT_INTERVAL;
+    vector<string> paths;
+    for (int i = 1; i < argc; ++i) {
+        string arg = args[i];
+        if (arg == "--interval" && i + 1 < argc) {
+            interval = static_cast<uint32_t>(max(1, atoi(args[++i])));
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() != 2) {
+        cout << "usage: diverge [--interval N] a.snr b.snr" << endl;
+        return 2;
+    }
+
+    Replay replays[2];
+    for (int i = 0; i < 2; ++i) {
+        if (!loadReplay(paths[i].c_str(), replays[i])) {
+            return 2;
+        }
+    }
+    if (replays[0].header.boardWidth != replays[1].header.boardWidth
+        || replays[0].header.boardHeight != replays[1].header.boardHeight) {
+        cout << "The replays are for different boards" << endl;
+        return 1;
+    }
+
+    //The evidence first: each recording against this build, and against each other
+    auto start = chrono::steady_clock::now();
+    uint64_t simulated = 0;
+    vector<Recorded> checkpoints[2] = { recorded(replays[0]), recorded(replays[1]) };
+    Agreement builds[2];
+    for (int i = 0; i < 2; ++i) {
+        Simulation sim(replays[i].header.boardWidth, replays[i].header.boardHeight);
+        builds[i] = resimulate(replays[i], checkpoints[i], sim, simulated);
+        describe(paths[i], replays[i], checkpoints[i], builds[i]);
+    }
+    Agreement recordings = compareRecorded(checkpoints[0], checkpoints[1]);
+    if (recordings.compared == 0) {
+        cout << "The recordings have no checkpoint at the same tick" << endl;
+    } else if (recordings.bad == NONE) {
+        cout << "The recordings agree at all " << recordings.compared << " checkpoints they share" << endl;
+    } else {
+        cout << "The recordings agree through " << tickText(recordings.good) << " and differ at tick " << recordings.bad
+             << endl;
+    }
+
+    if (builds[0].bad != NONE || builds[1].bad != NONE) {
+        //Re-simulating can't stand in for a build that ran different rules, so this is as far as it goes
+        int first = builds[1].bad == NONE || (builds[0].bad != NONE && builds[0].bad <= builds[1].bad) ? 0 : 1;
+        cout << endl;
+        if (builds[1 - first].bad != NONE && recordings.compared > 0 && recordings.bad == NONE) {
+            cout << "Both recordings agree with each other but not with this build" << endl;
+        }
+        for (int i = 0; i < 2; ++i) {
+            if (builds[i].bad != NONE) {
+                reportBuild(paths[i], replays[i], checkpoints[i], builds[i]);
+            }
+        }
+        logFlush();
+        return 1;
+    }
+
+    //This build reproduces whatever both recordings checked, so re-simulating them stands in
+    //for the builds that recorded them: a difference is in the inputs, seeds or levels
+    Side sides[2] = { Side(replays[0]), Side(replays[1]) };
+    for (auto& side : sides) {
+        side.sim.setLevel(side.replay->header.level);
+        side.sim.reset(side.replay->header.seed);
+    }
+    uint32_t end = max(replays[0].ticks, replays[1].ticks);
+
+    //Checkpoints until the hashes differ, keeping only the last one that matched
+    Checkpoint good;
+    save(good, sides);
+    uint32_t bad = 0;
+    bool diverged = !same(sides[0], sides[1]);
+    while (!diverged && good.tick < end) {
+        uint32_t target = min(good.tick + interval, end);
+        for (auto& side : sides) {
+            replayAdvance(*side.replay, side.sim, target, side.next);
+            simulated += side.sim.tick - good.tick;
+        }
+        if (!same(sides[0], sides[1])) {
+            diverged = true;
+            bad = target;
+        } else if (sides[0].sim.tick < target) {
+            break;//both games ended the same way
+        } else {
+            save(good, sides);
+        }
+    }
+
+    //Bisect the interval: the state at good.tick matches, the state at bad does not
+    uint32_t probes = 0;
+    if (diverged && bad > 0) {
+        while (bad - good.tick > 1) {
+            uint32_t mid = good.tick + (bad - good.tick) / 2;
+            restore(good, sides);
+            for (auto& side : sides) {
+                replayAdvance(*side.replay, side.sim, mid, side.next);
+                simulated += side.sim.tick - good.tick;
+            }
+            probes++;
+            if (same(sides[0], sides[1])) {
+                save(good, sides);
+            } else {
+                bad = mid;
+            }
+        }
+        restore(good, sides);
+        for (auto& side : sides) {
+            replayAdvance(*side.replay, side.sim, bad, side.next);
+        }
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << endl;
+    if (!diverged) {
+        cout << "No divergence: both games match through tick " << sides[0].sim.tick << " (" << ms << " ms)" << endl;
+        logFlush();
+        return 0;
+    }
+    if (bad == 0) {
+        cout << "The games differ from the start: different seeds or levels (" << ms << " ms)" << endl;
+    } else {
+        cout << "First divergence at tick " << bad << ", made by the inputs or update of tick " << bad - 1 << " ("
+             << simulated << " ticks simulated, " << probes << " bisection steps, " << ms << " ms)" << endl;
+    }
+    dump(paths[0], sides[0].sim, replays[0], paths[1], sides[1].sim, replays[1]);
+    logFlush();
+    return 1;
+}
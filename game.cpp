@@ -1,77 +1,31 @@
-#include <SDL2/SDL.h>
-#include <SDL2/SDL_ttf.h>
-#include <SDL2/SDL_mixer.h>
+#include "game.h"
+#include "profiler.h"
+#include "perfstats.h"
+#include "alloc.h"
+#include "log.h"
 #include <SDL2/SDL_image.h>
-#include <iostream>
 #include <vector>
+#include <algorithm>
 #include <cstdlib>
-#include <ctime>
+#include <cstring>
 #include <cmath>
+#include <ctime>
 
 using namespace std;
 
-const int SCREEN_WIDTH = 640;
-const int SCREEN_HEIGHT = 480;
-const int CELL_SIZE = 20;
-const int FONT_SIZE = 28;
-const int FPS = 7;
-
-enum Direction { UP, DOWN, LEFT, RIGHT };
-
-struct Point {
-    int x, y;
-};
-
-class SnakeGame {
-public:
-    SnakeGame();
-    ~SnakeGame();
-    bool init();
-    void menu();
-    void run();
-
-private:
-    void handleEvents();
-    void update();
-    void render();
-    void render2();
-    void close();
-    void reset();
-    void spawnFood();
-    bool checkCollision();
-    void resume();
-    void help();
-    void level();
-    void renderText(const char* text, int x, int y, SDL_Color color);
-    SDL_Texture* loadTexture(const std::string& path);
-
-    SDL_Window* window;
-    SDL_Renderer* renderer;
-    SDL_Texture* texture;
-    SDL_Texture* foodTexture;
-    SDL_Texture* fieldTexture;
-    SDL_Texture* levelTexture;
-    TTF_Font* font;
-    Mix_Music* backgroundMusic;
-    bool running;
-    bool level2;
-    bool level3;
-    Direction dir;
-    Direction dir2;
-    Direction dir3;
-    vector<Point> snake;
-    Point food;
-    vector<Point> obs;
-    vector<Point> enemy1;
-    vector<Point> enemy2;
-    int score;
-    bool gameOver;
-};
-
-SnakeGame::SnakeGame()
-    : window(nullptr), renderer(nullptr), font(nullptr), texture(nullptr),fieldTexture(nullptr), 
-      levelTexture(nullptr), backgroundMusic(nullptr), running(true), dir(UP), score(0), 
-      gameOver(false) {srand(static_cast<unsigned int>(time(0)));
+static Uint64 countersToNs(Uint64 counts) {
+    return counts * 1000000000ull / SDL_GetPerformanceFrequency();
+}
+
+SnakeGame::SnakeGame(const GameOptions& options)
+    : options(options), boardWidth(options.boardWidth), boardHeight(options.boardHeight), window(nullptr),
+      renderer(nullptr), showResources(false), showPerf(false), running(true), tickCount(0), tickEvents(0), exporter(metrics),
+      sim(options.boardWidth, options.boardHeight), rewinding(false), speed(max(1, min(options.speed, MAX_SPEED))),
+      rateTicks(0), rateStart(0), ticksPerSecond(0), autopilot(options.boardWidth, options.boardHeight),
+      hamilton(options.boardWidth, options.boardHeight), autopiloting(options.autopilot) {
+    textures.setBudget(options.textureBudget);
+    sessionStamp[0] = '\0';
+    recordings = 0;
 }
 
 SnakeGame::~SnakeGame() {
@@ -79,135 +33,123 @@ SnakeGame::~SnakeGame() {
 }
 
 bool SnakeGame::init() {
+    allocTrackInstall();
+
+    if (options.headless) {
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
-        cout << "SDL could not initialize! SDL_Error: " << SDL_GetError() << endl;
+        LOG_ERROR("SDL could not initialize! SDL_Error: %s", SDL_GetError());
         return false;
     }
 
     if (TTF_Init() == -1) {
-        cout << "SDL_ttf could not initialize! TTF_Error: " << TTF_GetError() << endl;
+        LOG_ERROR("SDL_ttf could not initialize! TTF_Error: %s", TTF_GetError());
         return false;
     }
 
     if (!(IMG_Init(IMG_INIT_JPG) & IMG_INIT_JPG)) {
-        cout << "SDL_image could not initialize! IMG_Error: " << IMG_GetError() << endl;
+        LOG_ERROR("SDL_image could not initialize! IMG_Error: %s", IMG_GetError());
         return false;
     }
 
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
-        cout << "SDL_mixer initialization failed: " << Mix_GetError() << endl;
+    if (Mix_OpenAudio(AUDIO_FREQUENCY, MIX_DEFAULT_FORMAT, 2, options.audioBufferSize) < 0) {
+        LOG_ERROR("SDL_mixer initialization failed: %s", Mix_GetError());
         return false;
     }
 
-    window = SDL_CreateWindow("Snake Game", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+    window = SDL_CreateWindow("Snake Game", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, boardWidth, boardHeight,
+                              options.headless ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN);
     if (!window) {
-        cout << "Window could not be created! SDL_Error: " << SDL_GetError() << endl;
+        LOG_ERROR("Window could not be created! SDL_Error: %s", SDL_GetError());
         return false;
     }
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    renderer = SDL_CreateRenderer(window, -1, options.headless ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED);
     if (!renderer) {
-        cout << "Renderer could not be created! SDL_Error: " << SDL_GetError() << endl;
+        LOG_ERROR("Renderer could not be created! SDL_Error: %s", SDL_GetError());
         return false;
     }
+    textures.setRenderer(renderer);
+    labels.setRenderer(renderer);
 
-    font = TTF_OpenFont("NotoSans_ExtraCondensed-MediumItalic.ttf", FONT_SIZE);
+    font.reset(TTF_OpenFont(FONT_FILE, FONT_SIZE));
     if (!font) {
-        cout << "Failed to load font! TTF_Error: " << TTF_GetError() << endl;
+        LOG_ERROR("Failed to load font! TTF_Error: %s", TTF_GetError());
         return false;
     }
 
-    backgroundMusic = Mix_LoadMUS("snake_music.mp3");
+    backgroundMusic.reset(Mix_LoadMUS("snake_music.mp3"));
     if (!backgroundMusic) {
-        cout << "Failed to load background music! Mix_Error: " << Mix_GetError() << endl;
+        LOG_ERROR("Failed to load background music! Mix_Error: %s", Mix_GetError());
         return false;
     }
 
-    Mix_PlayMusic(backgroundMusic, -1); //Loop the music indefinitely
+    Mix_PlayMusic(backgroundMusic.get(), -1); //Loop the music indefinitely
+
+    if (!sfx.load(options.audioBufferSize)) {
+        return false;
+    }
+
+    if (options.watchdogPrefix != nullptr) {
+        watchdog.start(options.watchdogPrefix, 1000000u / options.tickRate);
+    }
+
+    if (options.metricsPort > 0) {
+        exporter.startHttp(options.metricsPort);
+    } else if (options.metricsFile != nullptr) {
+        exporter.startFile(options.metricsFile);
+    }
+
+    if (options.hwCountersPath != nullptr) {
+        hw.open(options.hwCountersPath);//optional, the game runs without it
+    }
 
-    foodTexture = loadTexture("snakefood.jpeg");
-    if (!foodTexture) {
+    if (options.replayPrefix != nullptr) {
+        time_t now = time(nullptr);
+        strftime(sessionStamp, sizeof(sessionStamp), "%Y%m%d-%H%M%S", localtime(&now));
+        replays.start();
+        keyframeState.reserve(4096);
+    }
+    if (options.rewindSeconds > 0) {
+        history.init(static_cast<size_t>(options.rewindSeconds) * options.tickRate, boardWidth, boardHeight);
+        LOG_INFO("Rewind history: %d s, %zu KB", options.rewindSeconds, history.bytes() / 1024);
+    }
+
+    if (!loadTexture(FOOD_IMAGE)) {
         return false;
     }
+    textures.pin(FOOD_IMAGE);//drawn every frame, never worth evicting
 
 
     reset();
     return true;
 }
 
-SDL_Texture* SnakeGame::loadTexture(const string& path) {
-    SDL_Texture* texture = nullptr;
-    SDL_Surface* surface = IMG_Load(path.c_str());
-    if (surface == nullptr) {
-        cout << "Failed to load image: " << IMG_GetError() << endl;
-        return nullptr;
-    }
-    texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_FreeSurface(surface);
-    return texture;
+// Owned by the texture cache, so callers must not destroy it
+SDL_Texture* SnakeGame::loadTexture(const char* path) {
+    PROFILE_ZONE("loadTexture");
+    return textures.get(path);
 }
 
 void SnakeGame::reset() {
-    snake.clear();
-    snake.push_back({ SCREEN_WIDTH/2, SCREEN_HEIGHT  });
-    snake.push_back({ SCREEN_WIDTH / 2 - CELL_SIZE, SCREEN_HEIGHT  });
-    snake.push_back({ SCREEN_WIDTH / 2 - 2 * CELL_SIZE, SCREEN_HEIGHT });
-    spawnFood();
-    dir = UP;
-    score = 0;
-    gameOver = false;
-
-    // Define the obstacle in the middle of the screen with length of 10 cells
-    obs.clear();
-    int startX = (SCREEN_WIDTH / 2) - (CELL_SIZE * 5);
-    int startY = (SCREEN_HEIGHT / 2)   - CELL_SIZE;
-    for (int i = 0; i < 10; ++i) {
-        obs.push_back({ startX + i * CELL_SIZE, startY });
-    }
-
-    //Define the enemies in the border of the screen;
-    
-    enemy1.clear();
-    enemy1.push_back({ SCREEN_WIDTH/2, 0  });
-    enemy1.push_back({ SCREEN_WIDTH / 2 - CELL_SIZE, SCREEN_HEIGHT });
-    enemy1.push_back({ SCREEN_WIDTH / 2 - 2 * CELL_SIZE, SCREEN_HEIGHT  });
-    dir2 = DOWN;
-
-    enemy2.clear();
-    enemy2.push_back({ 0-CELL_SIZE, SCREEN_HEIGHT/2 });
-    enemy2.push_back({ SCREEN_WIDTH / 2 - CELL_SIZE, SCREEN_HEIGHT });
-    enemy2.push_back({ SCREEN_WIDTH / 2 - 2 * CELL_SIZE, SCREEN_HEIGHT });
-    dir3 = RIGHT;
-    
+    reset(options.seed != 0 ? options.seed : clockSeed());
 }
 
-void SnakeGame::spawnFood() {
-    bool onSnake;
-    bool onObstacle;
-    do {
-        onSnake = false;
-        onObstacle = false;
-        food.x = (rand()  % ((SCREEN_WIDTH  / CELL_SIZE) -2) + 1) * CELL_SIZE;
-        food.y = (rand()  % ((SCREEN_HEIGHT / CELL_SIZE) - 2) + 1) * CELL_SIZE;
-
-        for (const auto& part : snake) {
-            if (part.x == food.x && part.y == food.y) {
-                onSnake = true;
-                break;
-            }
-        }
-
-        for (const auto& part : obs) {
-            if (part.x == food.x && part.y == food.y) {
-                onObstacle = true;
-                break;
-            }
-        }
-
-    } while (onSnake||onObstacle);
+void SnakeGame::reset(uint64_t gameSeed) {
+    replays.finish(sim.tick, sim.score, sim.gameOver);//only if a game was left unfinished
+    sim.reset(gameSeed);
+    history.clear();
+    autopilot.clear();
+    hamilton.clear();
+    rewinding = false;
 }
 
 void SnakeGame::handleEvents() {
+    PROFILE_ZONE("handleEvents");
+    ALLOC_PHASE(ALLOC_EVENTS);
     SDL_Event e;
     while (SDL_PollEvent(&e) != 0) {
         if (e.type == SDL_QUIT) {
@@ -216,22 +158,57 @@ void SnakeGame::handleEvents() {
         } else if (e.type == SDL_KEYDOWN) {
             switch (e.key.keysym.sym) {
                 case SDLK_UP:
-                    if (dir != DOWN) dir = UP;
+                    if (sim.dir != DOWN) sim.dir = UP;
+                    autopiloting = AUTOPILOT_OFF;
                     break;
                 case SDLK_DOWN:
-                    if (dir != UP) dir = DOWN;
+                    if (sim.dir != UP) sim.dir = DOWN;
+                    autopiloting = AUTOPILOT_OFF;
                     break;
                 case SDLK_LEFT:
-                    if (dir != RIGHT) dir = LEFT;
+                    if (sim.dir != RIGHT) sim.dir = LEFT;
+                    autopiloting = AUTOPILOT_OFF;
                     break;
                 case SDLK_RIGHT:
-                    if (dir != LEFT) dir = RIGHT;
+                    if (sim.dir != LEFT) sim.dir = RIGHT;
+                    autopiloting = AUTOPILOT_OFF;
                     break;
                 case SDLK_ESCAPE:
                     running = false;
                     break;
+                case SDLK_BACKSPACE:
+                    rewinding = true;
+                    break;
+                case SDLK_PAGEUP:
+                    rewind(10 * options.tickRate);
+                    break;
+                case SDLK_EQUALS:
+                case SDLK_KP_PLUS:
+                    changeSpeed(true);
+                    break;
+                case SDLK_MINUS:
+                case SDLK_KP_MINUS:
+                    changeSpeed(false);
+                    break;
+                case SDLK_F2:
+                    showPerf = !showPerf;
+                    break;
+                case SDLK_F3:
+                    showResources = !showResources;
+                    break;
+                case SDLK_F4:
+                    autopiloting = static_cast<AutopilotMode>((autopiloting + 1) % (AUTOPILOT_CYCLE + 1));
+                    LOG_INFO("Autopilot %s", autopiloting == AUTOPILOT_PATH ? "on, shortest path"
+                                             : autopiloting == AUTOPILOT_CYCLE ? "on, Hamiltonian cycle" : "off");
+                    break;
+                case SDLK_F9:
+                    PROFILE_DUMP(PROFILE_TRACE_FILE);
+                    break;
             }
         }
+        else if (e.type == SDL_KEYUP && e.key.keysym.sym == SDLK_BACKSPACE) {
+            rewinding = false;
+        }
         else if (e.type == SDL_MOUSEBUTTONDOWN) {
             int mouseX, mouseY;
             SDL_GetMouseState(&mouseX, &mouseY);
@@ -247,21 +224,9 @@ void SnakeGame::handleEvents() {
 }
 
 void SnakeGame::resume() {
-    SDL_SetRenderDrawColor(renderer, 86, 191, 0, 255);
-    SDL_RenderClear(renderer);
-
-    fieldTexture = loadTexture("snakeGameBlank.jpeg");
-    if (fieldTexture == nullptr) {
-        return;
-    }
-
-    SDL_RenderCopy(renderer, fieldTexture, NULL, NULL);
-
-    SDL_Color black = { 0, 0, 0, 255 };
-    
-    renderText("Press Enter to resume!", SCREEN_WIDTH / 2 - 90, SCREEN_HEIGHT / 2 + 10, black);
-
-    SDL_RenderPresent(renderer);
+    watchdog.disarm();
+    tickEvents |= TICK_PAUSED;
+    renderPause(nullptr);
 
     bool waiting = true;
     while (waiting) {
@@ -274,6 +239,14 @@ void SnakeGame::resume() {
                 if (e.key.keysym.sym == SDLK_RETURN) {
                     waiting = false;
                     run();//return to the game
+                } else if (e.key.keysym.sym == SDLK_s && options.snapshotPath != nullptr) {
+                    Uint64 start = SDL_GetPerformanceCounter();
+                    bool saved = writeSnapshot(options.snapshotPath, sim);
+                    LOG_INFO("Saved tick %u to %s in %.1f us", sim.tick, options.snapshotPath,
+                             countersToNs(SDL_GetPerformanceCounter() - start) / 1e3);
+                    renderPause(saved ? "Game saved" : "Could not save the game");
+                } else if (e.key.keysym.sym == SDLK_l && options.snapshotPath != nullptr) {
+                    renderPause(restore(options.snapshotPath) ? "Saved game loaded" : "No saved game to load");
                 }
             }
         }
@@ -281,12 +254,50 @@ void SnakeGame::resume() {
     close();
 }
 
+void SnakeGame::renderPause(const char* status) {
+    SDL_SetRenderDrawColor(renderer, 86, 191, 0, 255);
+    SDL_RenderClear(renderer);
+
+    SDL_Texture* fieldTexture = loadTexture("snakeGameBlank.jpeg");
+    if (fieldTexture == nullptr) {
+        return;
+    }
+
+    SDL_RenderCopy(renderer, fieldTexture, NULL, NULL);
+
+    SDL_Color black = { 0, 0, 0, 255 };
+    
+    renderText("Press Enter to resume!", SCREEN_WIDTH / 2 - 90, SCREEN_HEIGHT / 2 + 10, black);
+    if (options.snapshotPath != nullptr) {
+        renderText("S to save, L to load", SCREEN_WIDTH / 2 - 80, SCREEN_HEIGHT / 2 + 50, black);
+    }
+    if (status != nullptr) {
+        renderText(status, SCREEN_WIDTH / 2 - 80, SCREEN_HEIGHT / 2 + 90, black);
+    }
+
+    SDL_RenderPresent(renderer);
+}
+
+// A restored game can't be replayed from its seed, so the current recording ends here
+// and the restored one is not recorded
+bool SnakeGame::restore(const char* path) {
+    Simulation loaded = sim;
+    if (!readSnapshot(path, loaded)) {
+        return false;
+    }
+    replays.finish(sim.tick, sim.score, sim.gameOver);
+    sim = loaded;
+    history.clear();
+    LOG_INFO("Restored level %d at tick %u, score %d", sim.level(), sim.tick, sim.score);
+    return true;
+}
+
 
 void SnakeGame::help(){
     SDL_SetRenderDrawColor(renderer, 86, 191, 0, 255);
     SDL_RenderClear(renderer);
 
-    fieldTexture = loadTexture("snakeHelp.jpeg");
+    SDL_Texture* fieldTexture = loadTexture("snakeHelp.jpeg");
     if (fieldTexture == nullptr) {
         return;
     }
@@ -324,121 +335,110 @@ void SnakeGame::help(){
 }
 
 void SnakeGame::update() {
-    if (gameOver) {
-        return;
-    }
-
-    //Move the snake
-    Point newHead = snake[0];
-    switch (dir) {
-        case UP:    newHead.y -= CELL_SIZE; break;
-        case DOWN:  newHead.y += CELL_SIZE; break;
-        case LEFT:  newHead.x -= CELL_SIZE; break;
-        case RIGHT: newHead.x += CELL_SIZE; break;
+    PROFILE_ZONE("update");
+    ALLOC_PHASE(ALLOC_UPDATE);
+    int events = sim.step();
+    if (events & STEP_ATE) {
+        tickEvents |= TICK_ATE;
+        sfx.play(SFX_EAT);
     }
-
-    //Check for collisions
-    if (newHead.x < 0 || newHead.x >= SCREEN_WIDTH   || newHead.y < 0 || newHead.y >= SCREEN_HEIGHT) {
-        gameOver = true;
-        return;
+    if (events & STEP_DIED) {
+        setGameOver();
     }
-    for (const auto& part : snake ) {
-        if (newHead.x == part.x && newHead.y == part.y) {
-            gameOver = true;
+}
 
-            return;
+// One tick of play with everything recorded around it. The autopilot steers here rather
+// than in update(), which the replay viewer also runs.
+void SnakeGame::advance() {
+    if (autopiloting && !sim.gameOver) {
+        Direction next = autopiloting == AUTOPILOT_CYCLE ? hamilton.decide(sim) : autopilot.decide(sim);
+        if (next != sim.dir) {
+            sim.dir = next;
+            tickEvents |= TICK_INPUT;
+            replays.record(sim.tick, next);
         }
     }
-
-    if(level2){
-        for(const auto& part : obs){
-            if(newHead.x==part.x && newHead.y== part.y){
-                gameOver=true;
-                return;
-            }
-        }
+    history.record(sim);
+    update();
+    if (options.hashInterval > 0 && sim.tick % options.hashInterval == 0 && !sim.gameOver) {
+        replays.hash(sim.tick, sim.stateHash());
     }
-
-    if(level3){
-
-        if (dir2 == DOWN) {
-            enemy1[0].y += CELL_SIZE;  // Move head down
-            if (enemy1[0].y >= SCREEN_HEIGHT) {
-                enemy2[0].x += CELL_SIZE;   //Move head right
-                if (enemy2[0].x >= SCREEN_WIDTH) {
-                    dir2 = UP;  
-                } 
-            }
-        } else {
-            enemy1[0].y -= CELL_SIZE;  // Move head up
-            if (enemy1[0].y < 0) {
-                enemy2[0].x -= CELL_SIZE;  // Move head left
-                if (enemy2[0].x < 0) {
-                    dir2 = DOWN;  
-                }  
-            }
-        }
-
-        // Move the body segments of enemy1 to follow the head
-        for (int i = enemy1.size() - 1; i > 0; --i) {
-            enemy1[i] = enemy1[i - 1];  // Each segment follows the previous one
-        }
-
-        // Move the body segments of enemy2 to follow the head
-        for (int i = enemy2.size() - 1; i > 0; --i) {
-            enemy2[i] = enemy2[i - 1];  // Each segment follows the previous one
-        }
-
-
+    if (options.keyframeInterval > 0 && sim.tick % options.keyframeInterval == 0 && !sim.gameOver) {
+        keyframeState.clear();
+        sim.saveState(keyframeState);//state before the next tick's input
+        replays.keyframe(sim.tick, keyframeState);
     }
+}
 
-    if(level3){
-        for(const auto& part : snake){
-            
-                if(enemy1[0].x==part.x && enemy1[0].y== part.y){
-                    gameOver=true;
-                    return;
-                }
-            
-        }
-
-        for(const auto& part : snake){
+// 1, 2, 5, 10, 20, 50 ... up to MAX_SPEED
+void SnakeGame::changeSpeed(bool faster) {
+    int step = 1;
+    while (step * 10 <= speed) {
+        step *= 10;
+    }
+    int digit = speed / step;
+    if (faster) {
+        speed = digit == 1 ? 2 * step : digit == 2 ? 5 * step : 10 * step;
+    } else if (speed > 1) {
+        speed = digit == 1 ? step / 2 : digit == 2 ? step : 2 * step;
+    }
+    speed = max(1, min(speed, MAX_SPEED));
+    ticksPerSecond = 0;
+    rateTicks = 0;
+    rateStart = SDL_GetTicks();
+    LOG_INFO("Speed %dx", speed);
+}
 
-                if(enemy2[0].x==part.x && enemy2[0].y== part.y){
-                    gameOver=true;
-                    return;
-                }
-            
-        }
+void SnakeGame::countTicks(uint32_t ticks) {
+    rateTicks += ticks;
+    Uint32 now = SDL_GetTicks();
+    if (now - rateStart >= 1000) {
+        ticksPerSecond = static_cast<int>(rateTicks * 1000ull / (now - rateStart));
+        rateTicks = 0;
+        rateStart = now;
     }
+}
 
-    snake.insert(snake.begin(), newHead);
+void SnakeGame::renderTurbo() {
+    SDL_Color black = { 0, 0, 0, 255 };
+    char line[64];
+    snprintf(line, sizeof(line), "%dx  %d ticks/s", speed, ticksPerSecond);
+    renderText(line, 10, 45, black);
+}
 
-    if (newHead.x == food.x && newHead.y == food.y) {
-        score += 10;
-        spawnFood();
+void SnakeGame::renderAutopilot(int y) {
+    SDL_Color black = { 0, 0, 0, 255 };
+    char line[64];
+    if (autopiloting == AUTOPILOT_CYCLE) {
+        const HamiltonStats& stats = hamilton.stats();
+        snprintf(line, sizeof(line), "Cycle  %.1f%% shortcuts",
+                 100.0 * stats.shortcuts / max<uint64_t>(stats.decisions, 1));
     } else {
-        snake.pop_back();
+        const AutopilotStats& stats = autopilot.stats();
+        snprintf(line, sizeof(line), "Autopilot  %.1f nodes/decision",
+                 static_cast<double>(stats.nodesExpanded) / max<uint64_t>(stats.decisions, 1));
     }
+    renderText(line, 10, y, black);
+}
+
+void SnakeGame::setGameOver() {
+    tickEvents |= TICK_DIED;
+    metrics.recordGame(sim.level(), sim.score);
+    replays.finish(sim.tick, sim.score, true);
+    sfx.play(SFX_DIE);
 }
 
 void SnakeGame::level(){
     SDL_SetRenderDrawColor(renderer, 86, 191, 0, 255);
     SDL_RenderClear(renderer);
 
-    levelTexture = loadTexture("SnakegameLevel.jpeg");
-    if (levelTexture == nullptr) {
-        return;
-    }
-
-    SDL_RenderCopy(renderer, levelTexture, NULL, NULL);
-
     bool quit = false;
     SDL_Event e;
-    level2 = false;
-    level3 = false;
+    sim.level2 = false;
+    sim.level3 = false;
 
     while (!quit) {
+        textures.nextFrame();
         while (SDL_PollEvent(&e) != 0) {
             if (e.type == SDL_QUIT) {
                 quit = true;
@@ -448,20 +448,30 @@ void SnakeGame::level(){
                 int mouseX, mouseY;
                 SDL_GetMouseState(&mouseX, &mouseY);
                 if (mouseX >= 130 && mouseX <= 300 && mouseY >= 150 && mouseY <= 200) {
+                    sfx.play(SFX_LEVEL_START);
                     run();//level 1
                 } else if (mouseX >= 130 && mouseX <= 300 && mouseY >= 220 && mouseY <= 270) {
-                    level2 = true;
+                    sim.level2 = true;
+                    sfx.play(SFX_LEVEL_START);
                     run();//level 2
                 }
                 else if (mouseX >= 130 && mouseX <= 300 && mouseY >= 290 && mouseY <= 320) {
-                    level2 = true;
-                    level3 = true;
+                    sim.level2 = true;
+                    sim.level3 = true;
+                    sfx.play(SFX_LEVEL_START);
                     run();//level 3
                 }
             }
         }
 
 
+        //Looked up every frame, never kept: a game started from here can evict it under --vram-budget
+        SDL_Texture* levelTexture = loadTexture("SnakegameLevel.jpeg");
+        if (levelTexture == nullptr) {
+            return;
+        }
+        SDL_RenderCopy(renderer, levelTexture, NULL, NULL);
+
         SDL_Color black = { 0, 0, 0, 255 };
         renderText("LEVEL 1", 140, 160, black);
         renderText("LEVEL 2", 140, 230, black);
@@ -475,97 +485,132 @@ void SnakeGame::level(){
 
 
 void SnakeGame::renderText(const char* text, int x, int y, SDL_Color color) {
-    SDL_Surface* surface = TTF_RenderText_Solid(font, text, color);
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    int texW = 0, texH = 0;
-    SDL_QueryTexture(texture, NULL, NULL, &texW, &texH);
-    SDL_Rect dstRect = { x, y, texW, texH };
-    SDL_RenderCopy(renderer, texture, NULL, &dstRect);
-    SDL_FreeSurface(surface);
-    SDL_DestroyTexture(texture);
+    PROFILE_ZONE("renderText");
+    Surface surface(textSurface(font.get(), text, color));
+    if (!surface) {
+        return;
+    }
+    Texture texture(SDL_CreateTextureFromSurface(renderer, surface.get()));
+    SDL_Rect dstRect = { x, y, surface.get()->w, surface.get()->h };
+    SDL_RenderCopy(renderer, texture.get(), NULL, &dstRect);
+    frameCounters.drawCalls++;
 }
 
-
-
-
-void SnakeGame::render() {
-    SDL_SetRenderDrawColor(renderer, 86, 191, 0, 255);
-    SDL_RenderClear(renderer);
-
-    fieldTexture = loadTexture("snakeGameField.jpeg");
-    if (fieldTexture == nullptr) {
-        return;
+// Like renderText but the texture is kept, for text drawn every frame
+int SnakeGame::renderLabel(const char* text, int x, int y, SDL_Color color) {
+    int w = 0, h = 0;
+    SDL_Texture* texture = labels.get(font.get(), text, color, &w, &h);
+    if (texture == nullptr) {
+        return 0;
     }
+    SDL_Rect dstRect = { x, y, w, h };
+    SDL_RenderCopy(renderer, texture, NULL, &dstRect);
+    frameCounters.drawCalls++;
+    return w;
+}
 
-    SDL_RenderCopy(renderer, fieldTexture, NULL, NULL);
+// Drawn from cached per-digit labels so a changing score doesn't allocate
+void SnakeGame::renderScore(int x, int y, SDL_Color color) {
+    char digits[16];
+    snprintf(digits, sizeof(digits), "%d", sim.score);
+    x += renderLabel("Score: ", x, y, color);
+    for (const char* c = digits; *c != '\0'; ++c) {
+        char digit[2] = { *c, '\0' };
+        x += renderLabel(digit, x, y, color);
+    }
+}
 
-    
-    //Render snake
-    
-    for (const auto& part : snake) {
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_Rect fillRect = { part.x, part.y, CELL_SIZE, CELL_SIZE };
-        SDL_RenderFillRect(renderer, &fillRect);
-
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-        SDL_Rect borderRect = { part.x, part.y, CELL_SIZE, CELL_SIZE }; 
-        SDL_RenderDrawRect(renderer, &borderRect);
-    }
-
-    //Render food
-    SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
-    SDL_Rect foodRect = { food.x, food.y, CELL_SIZE, CELL_SIZE };
-    SDL_RenderCopy(renderer, foodTexture, nullptr, &foodRect);
-
-    if(level2){
-        for (const auto& part : obs) {
-            SDL_SetRenderDrawColor(renderer, 137, 87, 55, 255);
-            SDL_Rect fillRect = { part.x, part.y, CELL_SIZE, CELL_SIZE };
-            SDL_RenderFillRect(renderer, &fillRect);
-
-            SDL_SetRenderDrawColor(renderer, 94,48,35, 255);
-            SDL_Rect borderRect = { part.x, part.y, CELL_SIZE, CELL_SIZE }; 
-            SDL_RenderDrawRect(renderer, &borderRect);
+void SnakeGame::renderPerfOverlay() {
+    SDL_Color white = { 255, 255, 255, 255 };
+    char line[128];
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_Rect panel = { 5, 45, 330, 165 };
+    SDL_RenderFillRect(renderer, &panel);
+    frameCounters.drawCalls++;
+
+    snprintf(line, sizeof(line), "frame %.2f  p50 %.2f  p99 %.2f  max %.2f ms", stats.lastFrameNs / 1e6,
+             stats.frameTimes.percentile(0.5) / 1e6, stats.frameTimes.percentile(0.99) / 1e6,
+             stats.frameTimes.max() / 1e6);
+    renderText(line, 10, 45, white);
+    snprintf(line, sizeof(line), "tick %.3f  p50 %.3f  p99 %.3f  max %.3f ms", stats.lastTickNs / 1e6,
+             stats.tickTimes.percentile(0.5) / 1e6, stats.tickTimes.percentile(0.99) / 1e6,
+             stats.tickTimes.max() / 1e6);
+    renderText(line, 10, 75, white);
+    snprintf(line, sizeof(line), "draws %d  uploads %d  allocs %lld", stats.last.drawCalls,
+             stats.last.textureUploads, stats.last.allocations);
+    renderText(line, 10, 105, white);
+    snprintf(line, sizeof(line), "length %d  overlay %.2f ms", static_cast<int>(sim.snake.size()), stats.overlayNs / 1e6);
+    renderText(line, 10, 135, white);
+
+    //Rolling frame-time graph, full height is one tick budget
+    float budgetMs = 1000.0f / options.tickRate;
+    for (int i = 0; i < FRAME_HISTORY; ++i) {
+        float ms = stats.history[(stats.historyPos + i) % FRAME_HISTORY];
+        int h = static_cast<int>(min(ms / budgetMs, 1.0f) * 40);
+        SDL_Rect bar = { 10 + i * 2, 205 - h, 2, h };
+        if (ms > budgetMs) {
+            SDL_SetRenderDrawColor(renderer, 255, 60, 60, 255);
+        } else {
+            SDL_SetRenderDrawColor(renderer, 120, 255, 120, 255);
         }
+        SDL_RenderFillRect(renderer, &bar);
     }
+    frameCounters.drawCalls += FRAME_HISTORY;
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+}
 
-    if(level3){
-        for (const auto& part : enemy1) {
-            SDL_SetRenderDrawColor(renderer, 250, 0, 50, 255);
-            SDL_Rect fillRect = { part.x, part.y, CELL_SIZE, CELL_SIZE };
-            SDL_RenderFillRect(renderer, &fillRect);
+void SnakeGame::renderResources() {
+    SDL_Color white = { 255, 255, 255, 255 };
+    char line[96];
+    int y = boardHeight - 30 * RES_KIND_COUNT - 10;
+    for (int i = 0; i < RES_KIND_COUNT; ++i) {
+        const ResourceCounter& c = resourceCounters[i];
+        snprintf(line, sizeof(line), "%s: %d live, %lld KB", resourceKindName(static_cast<ResourceKind>(i)),
+                 c.live, c.bytes / 1024);
+        renderText(line, 10, y, white);
+        y += 30;
+    }
+    snprintf(line, sizeof(line), "cached %zu KB, evicted %d", textures.bytes() / 1024, textures.evictions());
+    renderText(line, 330, boardHeight - 40, white);
+}
 
-            SDL_SetRenderDrawColor(renderer, 94,48,35, 255);
-            SDL_Rect borderRect = { part.x, part.y, CELL_SIZE, CELL_SIZE }; 
-            SDL_RenderDrawRect(renderer, &borderRect);
-        }
 
-        for (const auto& part : enemy2) {
-            SDL_SetRenderDrawColor(renderer, 0, 0, 230, 255);
-            SDL_Rect fillRect = { part.x, part.y, CELL_SIZE, CELL_SIZE };
-            SDL_RenderFillRect(renderer, &fillRect);
 
-            SDL_SetRenderDrawColor(renderer, 94,48,35, 255);
-            SDL_Rect borderRect = { part.x, part.y, CELL_SIZE, CELL_SIZE }; 
-            SDL_RenderDrawRect(renderer, &borderRect);
-        }
+
+void SnakeGame::render() {
+    PROFILE_ZONE("render");
+    ALLOC_PHASE(ALLOC_RENDER);
+    SDL_Texture* fieldTexture = loadTexture(FIELD_IMAGE);
+    if (fieldTexture == nullptr) {
+        return;
     }
+    frameCounters.drawCalls += drawScene(renderer, sim, fieldTexture, loadTexture(FOOD_IMAGE));
+
+    SDL_Color black = { 0, 0, 0, 255 };
 
     //Render score
-    SDL_Color textColor = { 0, 0, 0, 255 };
-    string scoreText = "Score: " + to_string(score);
-    SDL_Surface* textSurface = TTF_RenderText_Solid(font, scoreText.c_str(), textColor);
-    SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-    int textWidth = textSurface->w;
-    int textHeight = textSurface->h;
-    SDL_FreeSurface(textSurface);
-    SDL_Rect renderQuad = { 10, 10, textWidth, textHeight };
-    SDL_RenderCopy(renderer, textTexture, nullptr, &renderQuad);
-    SDL_DestroyTexture(textTexture);
+    renderScore(10, 10, black);
 
     //Render Pause button
-    SDL_Color black = { 0, 0, 0, 255 };
-    renderText("Pause", 550, 10, black);
+    renderLabel("Pause", 550, 10, black);
+
+    if (speed > 1) {
+        renderTurbo();
+    }
+    if (autopiloting) {
+        renderAutopilot(speed > 1 ? 80 : 45);
+    }
+
+    if (showResources) {
+        renderResources();
+    }
+    if (showPerf) {
+        Uint64 overlayStart = SDL_GetPerformanceCounter();
+        renderPerfOverlay();
+        stats.overlayNs = countersToNs(SDL_GetPerformanceCounter() - overlayStart);
+    }
 
     SDL_RenderPresent(renderer);
 
@@ -577,31 +622,21 @@ void SnakeGame::render() {
 
 
 void SnakeGame::close() {
-    if (backgroundMusic != nullptr) {
+    replays.finish(sim.tick, sim.score, sim.gameOver);
+    replays.stop();
+    watchdog.stop();
+    exporter.stop();
+    sfx.close();
+    hw.close();
+
+    if (backgroundMusic) {
         Mix_HaltMusic();
-        Mix_FreeMusic(backgroundMusic);
-        backgroundMusic = nullptr;
-    }
-
-    if (texture != nullptr) {
-        SDL_DestroyTexture(texture);
-        texture = nullptr;
+        backgroundMusic.reset();
     }
 
-    if(foodTexture != nullptr){
-        SDL_DestroyTexture(foodTexture);
-        foodTexture = nullptr;
-    }
-
-    if(fieldTexture != nullptr){
-        SDL_DestroyTexture(fieldTexture);
-        fieldTexture = nullptr;
-    }
-
-    if(levelTexture != nullptr){
-        SDL_DestroyTexture(levelTexture);
-        levelTexture = nullptr;
-    }
+    //Textures belong to the renderer, so they go first
+    textures.clear();
+    labels.clear();
 
     if (renderer != nullptr) {
         SDL_DestroyRenderer(renderer);
@@ -613,10 +648,7 @@ void SnakeGame::close() {
         window = nullptr;
     }
 
-    if (font != nullptr) {
-        TTF_CloseFont(font);
-        font = nullptr;
-    }
+    font.reset();
 
     Mix_Quit();
     IMG_Quit();
@@ -632,18 +664,19 @@ void SnakeGame::menu() {
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
 
-    texture = loadTexture("GameInterface.jpeg");
-    if (texture == nullptr) {
-        return;
-    }
-
     bool quit = false;
     SDL_Event e;
 
     
 
     while (!quit) {
+        textures.nextFrame();
 
+        //Looked up every frame, never kept: help() and level() can evict it under --vram-budget
+        SDL_Texture* texture = loadTexture("GameInterface.jpeg");
+        if (texture == nullptr) {
+            return;
+        }
         SDL_RenderCopy(renderer, texture, NULL, NULL);
 
         SDL_Color black = { 0, 0, 0, 255 };
@@ -690,30 +723,83 @@ void SnakeGame::run() {
     Uint32 frameStart;
     int frameTime;
 
+    if (options.replayPrefix != nullptr && sim.tick == 0 && !replays.recording()) {
+        beginRecording();//not when resuming from the pause screen
+    }
+
     while (running) {
         frameStart = SDL_GetTicks();
+        Uint64 frameCounterStart = SDL_GetPerformanceCounter();
+        textures.nextFrame();
 
 
-        handleEvents();
+        Direction previousDir = sim.dir;
+        {
+            HwPhaseScope phase(hw, HW_EVENTS);
+            handleEvents();
+        }
+        if (sim.dir != previousDir) {
+            tickEvents |= TICK_INPUT;
+            replays.record(sim.tick, sim.dir);
+        }
 
         if (!running) {
             break; // If quit event is detected, exit the loop
         }
 
-        update();
-        render();
+        Uint64 tickStart = SDL_GetPerformanceCounter();
+        if (rewinding) {
+            rewind(speed);//speed ticks back per frame while Backspace is held
+        } else {
+            HwPhaseScope phase(hw, HW_UPDATE);
+            uint32_t before = sim.tick;
+            for (int i = 0; i < speed && !sim.gameOver; ++i) {
+                advance();//only the last state is drawn
+            }
+            countTicks(sim.tick - before);
+        }
+        Uint64 renderStart = SDL_GetPerformanceCounter();
+        stats.recordTick(countersToNs(renderStart - tickStart));
+        {
+            HwPhaseScope phase(hw, HW_RENDER);
+            render();
+        }
+        Uint64 frameEnd = SDL_GetPerformanceCounter();
 
         frameTime = SDL_GetTicks() - frameStart;
+        stats.endFrame(countersToNs(frameEnd - frameCounterStart));
+        hw.endFrame(stats.lastFrameNs);
+        metrics.recordFrame();
+        metrics.recordTick(stats.lastFrameNs);
+        metrics.setLiveTextures(resourceCounters[RES_TEXTURE].live, resourceCounters[RES_TEXTURE].bytes);
+
+        if (watchdog.active()) {
+            TickRecord record;
+            record.tick = tickCount;
+            record.eventsUs = static_cast<uint32_t>(countersToNs(tickStart - frameCounterStart) / 1000);
+            record.updateUs = static_cast<uint32_t>(countersToNs(renderStart - tickStart) / 1000);
+            record.renderUs = static_cast<uint32_t>(countersToNs(frameEnd - renderStart) / 1000);
+            record.totalUs = static_cast<uint32_t>(stats.lastFrameNs / 1000);
+            record.events = tickEvents | (record.totalUs > 1000000u / options.tickRate ? TICK_OVERRUN : 0);
+            record.snakeLength = static_cast<uint16_t>(sim.snake.size());
+            record.score = sim.score;
+            watchdog.endTick(record);
+        }
+        tickCount++;
+        tickEvents = 0;
 
-        if (frameTime < 1000 / FPS) {
-            SDL_Delay((1000 / FPS) - frameTime);
+        int tickMs = 1000 / options.tickRate;
+        if (frameTime < tickMs) {
+            PROFILE_ZONE("SDL_Delay");
+            SDL_Delay(tickMs - frameTime);
         }
 
-        if (gameOver) {
+        if (sim.gameOver) {
+            watchdog.disarm();//waiting on the game over screen is not a stall
             SDL_SetRenderDrawColor(renderer, 86, 191, 0, 255);
             SDL_RenderClear(renderer);
 
-            fieldTexture = loadTexture("snakeGameover.jpeg");
+            SDL_Texture* fieldTexture = loadTexture("snakeGameover.jpeg");
             if (fieldTexture == nullptr) {
                 return;
             }
@@ -722,9 +808,12 @@ void SnakeGame::run() {
 
             SDL_Color black = { 0, 0, 0, 255 };
             
-            string finalScore = "Final Score: " + to_string(score);
+            string finalScore = "Final Score: " + to_string(sim.score);
             renderText(finalScore.c_str(), SCREEN_WIDTH / 2 - 70, SCREEN_HEIGHT / 2, black);
             renderText("Press Enter to return to the menu", SCREEN_WIDTH / 2 - 150, SCREEN_HEIGHT / 2 + 50, black);
+            char seedText[40];
+            snprintf(seedText, sizeof(seedText), "Seed: %llu", static_cast<unsigned long long>(sim.seed));
+            renderText(seedText, SCREEN_WIDTH / 2 - 150, SCREEN_HEIGHT / 2 + 100, black);
 
             SDL_RenderPresent(renderer);
 
@@ -746,9 +835,6 @@ void SnakeGame::run() {
                 }
             }
 
-            SDL_DestroyTexture(fieldTexture);
-            fieldTexture = nullptr; 
-
             if (!running) { // If the game was quit during gameOver screen
                 break;
             }
@@ -758,18 +844,136 @@ void SnakeGame::run() {
         }
     }
 
+    watchdog.disarm();
     close();
 }
 
+void SnakeGame::beginRecording() {
+    ReplayHeader header;
+    memcpy(header.magic, "SNRP", 4);
+    header.version = REPLAY_VERSION;
+    header.level = static_cast<uint8_t>(sim.level());
+    header.reserved = 0;
+    header.boardWidth = static_cast<uint16_t>(boardWidth);
+    header.boardHeight = static_cast<uint16_t>(boardHeight);
+    header.seed = sim.seed;
+
+    //With --seed every game has the same seed, so the session and game number keep the names apart
+    char path[512];
+    snprintf(path, sizeof(path), "%s_%016llx_%s_%03d.snr", options.replayPrefix, static_cast<unsigned long long>(sim.seed),
+             sessionStamp, recordings++);
+    replays.begin(path, header);
+}
+
+// The recording can't follow a game that went backwards, so it ends at the first rewind
+// and the rest of the game is not recorded
+void SnakeGame::rewind(uint32_t ticks) {
+    if (history.ticks() == 0) {
+        return;
+    }
+    if (replays.recording()) {
+        replays.finish(sim.tick, sim.score, false);
+        LOG_INFO("Rewound at tick %u, the rest of this game is not recorded", sim.tick);
+    }
+    history.rewindTo(sim, sim.tick > ticks ? sim.tick - ticks : 0);
+}
+
+void SnakeGame::seekReplay(const Replay& replay, uint32_t target, size_t& nextInput) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    uint32_t from = replaySeek(replay, sim, target, nextInput);
+    LOG_INFO("Seek to tick %u: %.3f ms, simulated %u ticks from %s %u", target,
+             countersToNs(SDL_GetPerformanceCounter() - start) / 1e6, sim.tick - from,
+             from == 0 ? "the start at" : "keyframe", from);
+}
+
+// Plays a recording through the normal update and render, at the normal tick rate.
+// Space pauses, Left and Right seek back and forward 5 seconds, Home restarts.
+bool SnakeGame::playReplay(const char* path) {
+    Replay replay;
+    if (!loadReplay(path, replay)) {
+        return false;
+    }
+    if (replay.header.boardWidth != boardWidth || replay.header.boardHeight != boardHeight) {
+        LOG_ERROR("Replay %s is for a %dx%d board", path, replay.header.boardWidth, replay.header.boardHeight);
+        return false;
+    }
+    LOG_INFO("Replay %s: level %d, seed %llu, %u ticks, %d keyframes", path, replay.header.level,
+             static_cast<unsigned long long>(replay.header.seed), replay.ticks,
+             static_cast<int>(replay.keyframes.size()));
 
+    sim.setLevel(replay.header.level);
+    reset(replay.header.seed);
 
+    size_t next = 0;
+    bool paused = false;
+    bool checked = false;
+    bool matches = true;
+    uint32_t seekTicks = 5 * options.tickRate;
+    while (running) {
+        Uint32 frameStart = SDL_GetTicks();
+        textures.nextFrame();
 
-int main(int argc, char* args[]) {
-    SnakeGame game;
-    if (!game.init()) {
-        cout << "Failed to initialize!" << endl;
-        return -1;
+        SDL_Event e;
+        while (SDL_PollEvent(&e) != 0) {
+            if (e.type == SDL_QUIT) {
+                running = false;
+            } else if (e.type == SDL_KEYDOWN) {
+                switch (e.key.keysym.sym) {
+                    case SDLK_ESCAPE:
+                        running = false;
+                        break;
+                    case SDLK_SPACE:
+                        paused = !paused;
+                        break;
+                    case SDLK_LEFT:
+                        seekReplay(replay, sim.tick > seekTicks ? sim.tick - seekTicks : 0, next);
+                        break;
+                    case SDLK_RIGHT:
+                        seekReplay(replay, min(sim.tick + seekTicks, replay.ticks), next);
+                        break;
+                    case SDLK_HOME:
+                        seekReplay(replay, 0, next);
+                        break;
+                    case SDLK_F2:
+                        showPerf = !showPerf;
+                        break;
+                    case SDLK_EQUALS:
+                    case SDLK_KP_PLUS:
+                        changeSpeed(true);
+                        break;
+                    case SDLK_MINUS:
+                    case SDLK_KP_MINUS:
+                        changeSpeed(false);
+                        break;
+                }
+            }
+        }
+
+        bool atEnd = sim.gameOver || sim.tick >= replay.ticks;
+        if (!paused && !atEnd) {
+            uint32_t before = sim.tick;
+            for (int i = 0; i < speed && !sim.gameOver && sim.tick < replay.ticks; ++i) {
+                while (next < replay.inputs.size() && replay.inputs[next].tick <= sim.tick) {
+                    sim.dir = static_cast<Direction>(replay.inputs[next++].dir);
+                }
+                update();
+            }
+            countTicks(sim.tick - before);
+        } else if (atEnd && !checked) {
+            checked = true;//the first time the end is reached, seeking afterwards is just viewing
+            matches = !replay.complete || (sim.score == replay.score && sim.gameOver == replay.died);
+            if (!matches) {
+                LOG_ERROR("Replay %s diverged: score %d after %u ticks, recorded %d after %u", path, sim.score,
+                          sim.tick, replay.score, replay.ticks);
+            }
+        }
+        render();
+
+        int frameTime = SDL_GetTicks() - frameStart;
+        int tickMs = 1000 / options.tickRate;
+        if (frameTime < tickMs) {
+            SDL_Delay(tickMs - frameTime);
+        }
     }
-    game.menu();
-    return 0;
+    return matches;
 }
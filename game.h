@@ -0,0 +1,127 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <SDL2/SDL_mixer.h>
+#include "sound.h"
+#include "resources.h"
+#include "perfstats.h"
+#include "hwcounters.h"
+#include "watchdog.h"
+#include "metrics.h"
+#include "replay.h"
+#include "simulation.h"
+#include "scene.h"
+#include "snapshot.h"
+#include "rewind.h"
+#include "autopilot.h"
+#include "hamilton.h"
+#include <vector>
+
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+const int FPS = 7;
+const int MAX_SPEED = 1000;     // sim ticks per frame in turbo mode
+
+enum AutopilotMode { AUTOPILOT_OFF, AUTOPILOT_PATH, AUTOPILOT_CYCLE };   // F4 steps through them
+
+struct GameOptions {
+    int audioBufferSize = DEFAULT_AUDIO_BUFFER;
+    size_t textureBudget = 0;       // bytes, 0 = unlimited
+    bool headless = false;          // dummy video/audio drivers and a software renderer
+    int boardWidth = SCREEN_WIDTH;  // pixels, multiples of CELL_SIZE
+    int boardHeight = SCREEN_HEIGHT;
+    const char* hwCountersPath = nullptr;   // per-frame hardware counter CSV (Linux)
+    const char* watchdogPrefix = nullptr;   // flight recorder dumps, nullptr = no watchdog
+    int tickRate = FPS;                     // ticks per second
+    int metricsPort = 0;                    // Prometheus page on 127.0.0.1, 0 = off
+    const char* metricsFile = nullptr;      // or the same text rewritten periodically
+    uint64_t seed = 0;                      // food placement, 0 = a new seed from the clock every game
+    const char* replayPrefix = "replay";    // every game goes to <prefix>_<seed>_<session start>_<game>.snr, nullptr = off
+    int keyframeInterval = 0;               // ticks between seekable state keyframes in replays, 0 = none
+    int hashInterval = 0;                   // ticks between state hashes in replays for desync checks, 0 = none
+    const char* snapshotPath = "snake_save.snss";   // S on the pause screen saves the game here, L loads it
+    int rewindSeconds = 180;                // play Backspace can undo, 0 = no rewind
+    int speed = 1;                          // sim ticks per frame, 1 to MAX_SPEED, + and - change it
+    AutopilotMode autopilot = AUTOPILOT_OFF;    // a bot plays, F4 switches bots and the arrow keys take over
+};
+
+class SnakeGame {
+public:
+    SnakeGame(const GameOptions& options = GameOptions());
+    ~SnakeGame();
+    bool init();
+    void menu();
+    void run();
+    bool playReplay(const char* path);   // false if it could not be loaded or did not end as recorded
+    bool restore(const char* path);      // a saved game in place of the current one, run() continues it
+
+private:
+    friend class GameBench;
+    friend class GameRunner;
+
+    void handleEvents();
+    void update();
+    void render();
+    void render2();
+    void close();
+    void reset();
+    void reset(uint64_t gameSeed);
+    void setGameOver();
+    void resume();
+    void renderPause(const char* status);
+    void help();
+    void level();
+    void renderText(const char* text, int x, int y, SDL_Color color);
+    int renderLabel(const char* text, int x, int y, SDL_Color color);
+    void renderScore(int x, int y, SDL_Color color);
+    void renderResources();
+    void renderPerfOverlay();
+    SDL_Texture* loadTexture(const char* path);
+    void beginRecording();
+    void seekReplay(const Replay& replay, uint32_t target, size_t& nextInput);
+    void rewind(uint32_t ticks);
+    void advance();
+    void changeSpeed(bool faster);
+    void countTicks(uint32_t ticks);
+    void renderTurbo();
+    void renderAutopilot(int y);
+
+    GameOptions options;
+    int boardWidth;
+    int boardHeight;
+    SDL_Window* window;
+    SDL_Renderer* renderer;
+    TextureCache textures;
+    TextCache labels;
+    Font font;
+    Music backgroundMusic;
+    bool showResources;
+    bool showPerf;
+    FrameStats stats;
+    HwCounters hw;
+    TickWatchdog watchdog;
+    SoundEffects sfx;
+    bool running;
+    uint32_t tickCount;
+    Uint16 tickEvents;      // TickEvent bits for the flight recorder
+    GameMetrics metrics;
+    MetricsExporter exporter;
+    Simulation sim;
+    ReplayWriter replays;
+    char sessionStamp[16];  // when the game started, YYYYMMDD-HHMMSS, so replay names don't repeat across sessions
+    int recordings;         // replays begun this session
+    std::vector<uint8_t> keyframeState;
+    RewindHistory history;
+    bool rewinding;         // Backspace held
+    int speed;              // sim ticks per frame
+    uint32_t rateTicks;     // simulated since rateStart
+    Uint32 rateStart;
+    int ticksPerSecond;     // achieved over the last second, for the turbo readout
+    Autopilot autopilot;
+    HamiltonSolver hamilton;
+    AutopilotMode autopiloting;
+};
+
+#endif
@@ -0,0 +1,365 @@
+#include "hamilton.h"
+#include "log.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+const int STEP_X[4] = { 0, 0, -1, 1 };     // by Direction
+const int STEP_Y[4] = { -1, 1, 0, 0 };
+
+// Two full rounds of both sweeps: down and up the column, then right and left along the row
+uint32_t enemyRevisitTicks(const Simulation& sim) {
+    int cellsX = sim.boardWidth / CELL_SIZE, cellsY = sim.boardHeight / CELL_SIZE;
+    vector<uint32_t> lastVisit(static_cast<size_t>(cellsX) * cellsY, 0);
+    Point heads[2] = { sim.enemy1[0], sim.enemy2[0] };
+    Direction heading = sim.dir2;
+    uint32_t ticks = 8 * static_cast<uint32_t>(cellsX + cellsY + 2);
+    uint32_t longest = 0;
+    for (uint32_t tick = 1; tick <= ticks; ++tick) {
+        sim.moveEnemyHeads(heads[0], heads[1], heading);
+        for (const auto& head : heads) {
+            if (head.x < 0 || head.y < 0 || head.x >= sim.boardWidth || head.y >= sim.boardHeight) {
+                continue;
+            }
+            uint32_t& last = lastVisit[(head.y / CELL_SIZE) * cellsX + head.x / CELL_SIZE];
+            if (last != 0) {
+                longest = max(longest, tick - last);
+            }
+            last = tick;
+        }
+    }
+    return longest;
+}
+
+HamiltonSolver::HamiltonSolver(int boardWidth, int boardHeight)
+    : cellsX(boardWidth / CELL_SIZE), cellsY(boardHeight / CELL_SIZE), fallback(boardWidth, boardHeight),
+      enemies(boardWidth, boardHeight), ordered(false), expectTick(0), expectHead(-1) {}
+
+void HamiltonSolver::clear() {
+    fallback.clear();
+    enemies.clear();
+    ordered = false;
+}
+
+int HamiltonSolver::cellOf(const Point& p) const {
+    if (p.x < 0 || p.y < 0 || p.x >= cellsX * CELL_SIZE || p.y >= cellsY * CELL_SIZE) {
+        return -1;
+    }
+    return (p.y / CELL_SIZE) * cellsX + p.x / CELL_SIZE;
+}
+
+Direction HamiltonSolver::towards(const Point& from, int cell) const {
+    int dx = (cell % cellsX) * CELL_SIZE - from.x;
+    int dy = (cell / cellsX) * CELL_SIZE - from.y;
+    if (dx != 0) {
+        return dx > 0 ? RIGHT : LEFT;
+    }
+    return dy > 0 ? DOWN : UP;
+}
+
+static int findRoot(vector<int>& root, int i) {
+    while (root[i] != i) {
+        root[i] = root[root[i]];
+        i = root[i];
+    }
+    return i;
+}
+
+// The outline of a spanning tree over the free 2x2 blocks starting at (ox, oy), as next
+// cell per cell (-1 off it). Every block starts as its own clockwise loop and each tree
+// edge joins two loops by swapping the edges along their shared side. Rows of blocks are
+// joined first, then the rows to each other leftmost first, so the cycle runs in long
+// horizontal sweeps.
+static void blockCycle(int cellsX, int cellsY, const vector<uint8_t>& blocked, int ox, int oy, vector<int32_t>& next) {
+    int blocksX = (cellsX - ox) / 2, blocksY = (cellsY - oy) / 2;
+    auto corner = [&](int bx, int by, int dx, int dy) { return (oy + 2 * by + dy) * cellsX + ox + 2 * bx + dx; };
+    vector<uint8_t> freeBlock(blocksX * blocksY, 0);
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            freeBlock[by * blocksX + bx] = !blocked[corner(bx, by, 0, 0)] && !blocked[corner(bx, by, 1, 0)]
+                                           && !blocked[corner(bx, by, 0, 1)] && !blocked[corner(bx, by, 1, 1)];
+        }
+    }
+
+    vector<int> root(blocksX * blocksY);
+    for (size_t i = 0; i < root.size(); ++i) {
+        root[i] = static_cast<int>(i);
+    }
+    vector<pair<int, int>> edges;   // tree edges, block to its right or bottom neighbour
+    auto join = [&](int a, int b) {
+        if (freeBlock[a] && freeBlock[b] && findRoot(root, a) != findRoot(root, b)) {
+            root[findRoot(root, a)] = findRoot(root, b);
+            edges.push_back(make_pair(a, b));
+        }
+    };
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx + 1 < blocksX; ++bx) {
+            join(by * blocksX + bx, by * blocksX + bx + 1);
+        }
+    }
+    for (int bx = 0; bx < blocksX; ++bx) {
+        for (int by = 0; by + 1 < blocksY; ++by) {
+            join(by * blocksX + bx, (by + 1) * blocksX + bx);
+        }
+    }
+
+    //Only the largest tree becomes the cycle; the rest is left to widen()
+    vector<int> size(root.size(), 0);
+    int largest = -1;
+    for (size_t i = 0; i < root.size(); ++i) {
+        if (freeBlock[i]) {
+            int r = findRoot(root, static_cast<int>(i));
+            if (++size[r] > (largest < 0 ? 0 : size[largest])) {
+                largest = r;
+            }
+        }
+    }
+    next.assign(cellsX * cellsY, -1);
+    if (largest < 0) {
+        return;
+    }
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            int b = by * blocksX + bx;
+            if (freeBlock[b] && findRoot(root, b) == largest) {
+                next[corner(bx, by, 0, 0)] = corner(bx, by, 1, 0);
+                next[corner(bx, by, 1, 0)] = corner(bx, by, 1, 1);
+                next[corner(bx, by, 1, 1)] = corner(bx, by, 0, 1);
+                next[corner(bx, by, 0, 1)] = corner(bx, by, 0, 0);
+            }
+        }
+    }
+    for (const auto& edge : edges) {
+        if (findRoot(root, edge.first) != largest) {
+            continue;
+        }
+        int ax = edge.first % blocksX, ay = edge.first / blocksX;
+        int bx = edge.second % blocksX, by = edge.second / blocksX;
+        if (by == ay) {
+            next[corner(ax, ay, 1, 0)] = corner(bx, by, 0, 0);
+            next[corner(bx, by, 0, 1)] = corner(ax, ay, 1, 1);
+        } else {
+            next[corner(ax, ay, 1, 1)] = corner(bx, by, 1, 0);
+            next[corner(bx, by, 0, 0)] = corner(ax, ay, 0, 1);
+        }
+    }
+}
+
+// Takes in free cells the cycle missed two at a time: an edge u -> v with free cells a and
+// b beside it, a next to u and b next to v, becomes u -> a -> b -> v
+static void widen(int cellsX, int cellsY, const vector<uint8_t>& blocked, vector<int32_t>& next) {
+    bool grew = true;
+    while (grew) {
+        grew = false;
+        for (int u = 0; u < cellsX * cellsY; ++u) {
+            if (next[u] < 0) {
+                continue;
+            }
+            int v = next[u];
+            int dx = v % cellsX - u % cellsX, dy = v / cellsX - u / cellsX;
+            for (int side = -1; side <= 1; side += 2) {
+                int px = dy * side, py = dx * side;
+                int ax = u % cellsX + px, ay = u / cellsX + py;
+                int bx = v % cellsX + px, by = v / cellsX + py;
+                if (ax < 0 || ay < 0 || ax >= cellsX || ay >= cellsY || bx < 0 || by < 0 || bx >= cellsX || by >= cellsY) {
+                    continue;
+                }
+                int a = ay * cellsX + ax, b = by * cellsX + bx;
+                if (!blocked[a] && !blocked[b] && next[a] < 0 && next[b] < 0) {
+                    next[u] = a;
+                    next[a] = b;
+                    next[b] = v;
+                    grew = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Tries the four ways 2x2 blocks can line up with the board and keeps the cycle that
+// misses the fewest cells food can appear on (all but the outermost ring)
+HamiltonCycle HamiltonSolver::build(const vector<uint8_t>& blocked) const {
+    auto start = chrono::steady_clock::now();
+    int cells = cellsX * cellsY;
+    HamiltonCycle best;
+    best.missed = -1;
+    vector<int32_t> next;
+    for (int offset = 0; offset < 4; ++offset) {
+        blockCycle(cellsX, cellsY, blocked, offset & 1, offset >> 1, next);
+        widen(cellsX, cellsY, blocked, next);
+
+        int missed = 0;
+        for (int y = 1; y + 1 < cellsY; ++y) {
+            for (int x = 1; x + 1 < cellsX; ++x) {
+                int cell = y * cellsX + x;
+                missed += !blocked[cell] && next[cell] < 0 ? 1 : 0;
+            }
+        }
+        size_t covered = static_cast<size_t>(count_if(next.begin(), next.end(), [](int32_t n) { return n >= 0; }));
+        if (best.missed >= 0 && (missed > best.missed || (missed == best.missed && covered <= best.cells.size()))) {
+            continue;
+        }
+        best.missed = missed;
+        best.position.assign(cells, -1);
+        best.cells.clear();
+        int first = static_cast<int>(find_if(next.begin(), next.end(), [](int32_t n) { return n >= 0; }) - next.begin());
+        for (int cell = first; cell < cells && best.position[cell] < 0; cell = next[cell]) {
+            best.position[cell] = static_cast<int32_t>(best.cells.size());
+            best.cells.push_back(cell);
+        }
+        if (missed == 0 && best.cells.size() == static_cast<size_t>(cells - count(blocked.begin(), blocked.end(), 1))) {
+            break;//every free cell, nothing can do better
+        }
+    }
+    best.buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return best;
+}
+
+// The board layout is the board size and, from level 2 on, the obstacle
+const HamiltonCycle& HamiltonSolver::cycleFor(const Simulation& sim) {
+    uint64_t key = 14695981039346656037ull;//FNV-1a
+    auto add = [&](int value) {
+        key = (key ^ static_cast<uint32_t>(value)) * 1099511628211ull;
+    };
+    add(cellsX);
+    add(cellsY);
+    if (sim.level2) {
+        for (const auto& part : sim.obs) {
+            add(part.x);
+            add(part.y);
+        }
+    }
+    auto found = cycles.find(key);
+    if (found != cycles.end()) {
+        return found->second;
+    }
+
+    vector<uint8_t> blocked(cellsX * cellsY, 0);
+    if (sim.level2) {
+        for (const auto& part : sim.obs) {
+            int cell = cellOf(part);
+            if (cell >= 0) {
+                blocked[cell] = 1;
+            }
+        }
+    }
+    HamiltonCycle& cycle = cycles[key] = build(blocked);
+    counters.builds++;
+    LOG_INFO("Hamiltonian cycle for %dx%d level %d: %zu cells, %d food cells missed, %.2f ms", cellsX, cellsY,
+             sim.level(), cycle.cells.size(), cycle.missed, cycle.buildMs);
+    return cycle;
+}
+
+// Whether the body lies along the cycle, tail to head in cycle order
+bool HamiltonSolver::onCycle(const Simulation& sim, const HamiltonCycle& cycle) const {
+    int n = static_cast<int>(cycle.cells.size());
+    int tail = cellOf(sim.snake.back());
+    if (n == 0 || tail < 0 || cycle.position[tail] < 0) {
+        return false;
+    }
+    int previous = -1;
+    for (size_t i = sim.snake.size(); i-- > 0;) {
+        int cell = cellOf(sim.snake[i]);
+        if (cell < 0 || cycle.position[cell] < 0) {
+            return false;
+        }
+        int along = (cycle.position[cell] - cycle.position[tail] + n) % n;
+        if (along <= previous) {
+            return false;
+        }
+        previous = along;
+    }
+    return true;
+}
+
+// Whether following the cycle from cell keeps the body out of the enemies' way for the
+// next few steps, so a crossing that will go wrong is seen while there is still a choice
+bool HamiltonSolver::clearAhead(const HamiltonCycle& cycle, int cell, uint32_t length) const {
+    int n = static_cast<int>(cycle.cells.size());
+    int at = cycle.position[cell];
+    for (uint32_t step = 1; step <= HAMILTON_LOOKAHEAD; ++step) {
+        if (enemies.crosses(cycle.cells[(at + step - 1) % n], step + 1, step + length + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Direction HamiltonSolver::decide(const Simulation& sim) {
+    counters.decisions++;
+    if (sim.snake.empty() || sim.gameOver) {
+        return sim.dir;
+    }
+    const HamiltonCycle& cycle = cycleFor(sim);
+    if (sim.level3) {
+        enemies.update(sim);
+    }
+    const Point& head = sim.snake[0];
+    int h = cellOf(head);
+    if (!ordered || sim.tick != expectTick || h != expectHead) {
+        ordered = onCycle(sim, cycle);//only after something other than this bot moved the snake
+    }
+    int n = static_cast<int>(cycle.cells.size());
+    int food = cellOf(sim.food);
+    uint32_t length = static_cast<uint32_t>(sim.snake.size());
+
+    if (!ordered || (food >= 0 && cycle.position[food] < 0)) {
+        //Back onto the cycle by following it where it is clear, or wherever the Autopilot goes
+        if (!ordered && h >= 0 && cycle.position[h] >= 0) {
+            int next = cycle.cells[(cycle.position[h] + 1) % n];
+            Point cell = { (next % cellsX) * CELL_SIZE, (next / cellsX) * CELL_SIZE };
+            if (!sim.checkCollision(cell) && !(sim.level3 && !clearAhead(cycle, next, length))) {
+                return towards(head, next);
+            }
+        }
+        counters.fallbacks++;
+        ordered = false;
+        return fallback.decide(sim);
+    }
+
+    int here = cycle.position[h];
+    int tail = cellOf(sim.snake.back());
+    int toTail = (cycle.position[tail] - here + n) % n;
+    int toFood = food >= 0 ? (cycle.position[food] - here + n) % n : 1;
+    bool cutting = static_cast<int>(length) < n / 2;
+    int room = max(2, (n - static_cast<int>(length)) / 2);
+    int best = -1, bestAhead = 0, safe = -1, safeAhead = 0;
+    for (int d = 0; d < 4; ++d) {
+        int cell = cellOf({ head.x + STEP_X[d] * CELL_SIZE, head.y + STEP_Y[d] * CELL_SIZE });
+        if (cell < 0 || cycle.position[cell] < 0) {
+            continue;
+        }
+        int ahead = (cycle.position[cell] - here + n) % n;
+        if (ahead < 1 || ahead > toFood || ahead >= toTail || (ahead > 1 && (!cutting || ahead > toTail - room))) {
+            continue;
+        }
+        if (ahead > bestAhead) {
+            best = cell;
+            bestAhead = ahead;
+        }
+        if (ahead > safeAhead && !(sim.level3 && !clearAhead(cycle, cell, length))) {
+            safe = cell;
+            safeAhead = ahead;
+        }
+    }
+    if (sim.level3 && safe != best) {
+        counters.dodges++;
+        if (safe < 0) {
+            //Every move along the cycle crosses an enemy: the Autopilot may find a way round
+            ordered = false;
+            return fallback.decide(sim);
+        }
+        best = safe;
+        bestAhead = safeAhead;
+    }
+    if (best < 0) {
+        counters.fallbacks++;//the cycle is full up to the tail: the board is won
+        return fallback.decide(sim);
+    }
+    counters.shortcuts += bestAhead > 1 ? 1 : 0;
+    expectTick = sim.tick + 1;
+    expectHead = best;
+    return towards(head, best);
+}
@@ -0,0 +1,78 @@
+#ifndef HAMILTON_H
+#define HAMILTON_H
+
+#include "simulation.h"
+#include "autopilot.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// A bot that cannot trap itself: it follows a Hamiltonian cycle over the free cells, so
+// the body always lies along the stretch of cycle behind the head and the stretch ahead
+// is empty. It may cut ahead along the cycle towards the food, as long as it lands at
+// least two cells short of the tail, one for the tail itself and one in case it grows.
+//
+// The cycle comes from a spanning tree over 2x2 blocks of free cells, with its outline
+// walked as the cycle, then widened over the cells the blocks missed (around the level 2
+// obstacle, or a row or column left over by odd sizes) by replacing an edge of the
+// cycle with a detour through two neighbouring cells. It is built once per board layout
+// and kept. Cells it still misses are left to the Autopilot, as is any position that is
+// not the cycle's, until the snake is back on it.
+//
+// Level 3 is not supported, only played as well as it goes. The enemies sweep a column and
+// a row of the board, and each of their cells is back under an enemy head within
+// enemyRevisitTicks() (120 on 32x24). A body crossing them lies there as many ticks as the
+// snake is long, so a longer snake is hit wherever it crosses and the board can't be
+// filled. Before that a move is avoided when an enemy head would cut through the stretch
+// of cycle after it and another move is allowed; when none is, the Autopilot steers.
+
+const uint32_t HAMILTON_LOOKAHEAD = 16;     // cycle cells checked for enemies past a move on level 3
+
+struct HamiltonCycle {
+    std::vector<int32_t> position;  // of each cell on the cycle, -1 off it
+    std::vector<int32_t> cells;     // in cycle order
+    int missed;                     // free cells off the cycle where food can appear
+    double buildMs;
+};
+
+struct HamiltonStats {
+    uint64_t decisions = 0;
+    uint64_t shortcuts = 0;         // moves that skipped ahead along the cycle
+    uint64_t dodges = 0;            // level 3 moves chosen to keep out of an enemy's way
+    uint64_t fallbacks = 0;         // decisions left to the Autopilot
+    int builds = 0;                 // cycles built, one per board layout
+};
+
+// The most ticks any cell the level 3 enemy heads pass over goes without one, from sim's
+// enemies as reset() places them
+uint32_t enemyRevisitTicks(const Simulation& sim);
+
+class HamiltonSolver {
+public:
+    HamiltonSolver(int boardWidth, int boardHeight);
+    Direction decide(const Simulation& sim);    // the direction for sim's next step()
+    void clear();                               // for a new game; the cycles are kept
+    const HamiltonStats& stats() const { return counters; }
+    const HamiltonCycle& cycleFor(const Simulation& sim);
+
+private:
+    int cellOf(const Point& p) const;
+    bool onCycle(const Simulation& sim, const HamiltonCycle& cycle) const;
+    bool clearAhead(const HamiltonCycle& cycle, int cell, uint32_t length) const;
+    Direction towards(const Point& from, int cell) const;
+    HamiltonCycle build(const std::vector<uint8_t>& blocked) const;
+
+    int cellsX;
+    int cellsY;
+    std::map<uint64_t, HamiltonCycle> cycles;   // by board layout
+    Autopilot fallback;
+    EnemyForecast enemies;
+    bool ordered;           // the body lies along the cycle behind the head
+    uint32_t expectTick;    // what the next decision should see if nothing else moved the snake
+    int expectHead;
+
+    HamiltonStats counters;
+};
+
+#endif
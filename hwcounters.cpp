@@ -0,0 +1,179 @@
+#include "hwcounters.h"
+#include "log.h"
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const char* PHASE_NAMES[HW_PHASE_COUNT] = { "events", "update", "render" };
+
+double HwPhaseTotals::ipc() const {
+    return values[HW_CYCLES] ? static_cast<double>(values[HW_INSTRUCTIONS]) / values[HW_CYCLES] : 0.0;
+}
+
+double HwPhaseTotals::cacheMissesPerKiloInstr() const {
+    return values[HW_INSTRUCTIONS] ? 1000.0 * values[HW_CACHE_MISSES] / values[HW_INSTRUCTIONS] : 0.0;
+}
+
+double HwPhaseTotals::branchMissesPerKiloInstr() const {
+    return values[HW_INSTRUCTIONS] ? 1000.0 * values[HW_BRANCH_MISSES] / values[HW_INSTRUCTIONS] : 0.0;
+}
+
+HwCounters::HwCounters() : leader(-1), frames(0), csv(nullptr) {
+    for (int i = 0; i < HW_COUNTER_COUNT; ++i) {
+        fds[i] = -1;
+        started[i] = 0;
+    }
+    memset(frame, 0, sizeof(frame));
+    memset(phaseTotals, 0, sizeof(phaseTotals));
+}
+
+HwCounters::~HwCounters() {
+    close();
+}
+
+#ifdef __linux__
+
+static int openCounter(uint64_t config, int groupFd) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = groupFd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+bool HwCounters::open(const char* csvPath) {
+    const uint64_t configs[HW_COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    //One group, so all four are scheduled together and read with a single read()
+    for (int i = 0; i < HW_COUNTER_COUNT; ++i) {
+        fds[i] = openCounter(configs[i], i == 0 ? -1 : fds[0]);
+        if (fds[i] < 0) {
+            LOG_ERROR("perf_event_open failed for counter %d: %s (check /proc/sys/kernel/perf_event_paranoid)",
+                      i, strerror(errno));
+            close();
+            return false;
+        }
+    }
+    leader = fds[0];
+
+    csv = fopen(csvPath, "w");
+    if (csv == nullptr) {
+        LOG_ERROR("Failed to open %s", csvPath);
+        close();
+        return false;
+    }
+    fprintf(csv, "frame,frame_ns");
+    for (int p = 0; p < HW_PHASE_COUNT; ++p) {
+        fprintf(csv, ",%s_cycles,%s_instructions,%s_cache_misses,%s_branch_misses",
+                PHASE_NAMES[p], PHASE_NAMES[p], PHASE_NAMES[p], PHASE_NAMES[p]);
+    }
+    fprintf(csv, "\n");
+
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+bool HwCounters::read(uint64_t* values) {
+    uint64_t buffer[1 + HW_COUNTER_COUNT];
+    if (::read(leader, buffer, sizeof(buffer)) != static_cast<ssize_t>(sizeof(buffer))) {
+        return false;
+    }
+    for (int i = 0; i < HW_COUNTER_COUNT; ++i) {
+        values[i] = buffer[1 + i];
+    }
+    return true;
+}
+
+void HwCounters::close() {
+    if (leader >= 0) {
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        printSummary();
+    }
+    for (int i = 0; i < HW_COUNTER_COUNT; ++i) {
+        if (fds[i] >= 0) {
+            ::close(fds[i]);
+            fds[i] = -1;
+        }
+    }
+    leader = -1;
+    if (csv != nullptr) {
+        fclose(csv);
+        csv = nullptr;
+    }
+}
+
+#else
+
+bool HwCounters::open(const char*) {
+    LOG_WARN("Hardware counters are only supported on Linux");
+    return false;
+}
+
+bool HwCounters::read(uint64_t*) {
+    return false;
+}
+
+void HwCounters::close() {}
+
+#endif
+
+void HwCounters::begin() {
+    read(started);
+}
+
+void HwCounters::end(HwPhase phase) {
+    uint64_t now[HW_COUNTER_COUNT];
+    if (!read(now)) {
+        return;
+    }
+    for (int i = 0; i < HW_COUNTER_COUNT; ++i) {
+        uint64_t delta = now[i] - started[i];
+        frame[phase][i] += delta;
+        phaseTotals[phase].values[i] += delta;
+    }
+    phaseTotals[phase].samples++;
+}
+
+void HwCounters::endFrame(uint64_t frameNs) {
+    if (csv == nullptr) {
+        return;
+    }
+    fprintf(csv, "%llu,%llu", static_cast<unsigned long long>(frames), static_cast<unsigned long long>(frameNs));
+    for (int p = 0; p < HW_PHASE_COUNT; ++p) {
+        for (int i = 0; i < HW_COUNTER_COUNT; ++i) {
+            fprintf(csv, ",%llu", static_cast<unsigned long long>(frame[p][i]));
+        }
+    }
+    fprintf(csv, "\n");
+    memset(frame, 0, sizeof(frame));
+    frames++;
+}
+
+void HwCounters::printSummary() const {
+    for (int p = 0; p < HW_PHASE_COUNT; ++p) {
+        const HwPhaseTotals& t = phaseTotals[p];
+        if (t.samples == 0) {
+            continue;
+        }
+        LOG_INFO("HW %s: %llu samples, %llu cycles avg, IPC %g, cache misses/kinstr %g, branch misses/kinstr %g",
+                 PHASE_NAMES[p], t.samples, t.values[HW_CYCLES] / t.samples, t.ipc(),
+                 t.cacheMissesPerKiloInstr(), t.branchMissesPerKiloInstr());
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef HWCOUNTERS_H
+#define HWCOUNTERS_H
+
+#include <cstdint>
+#include <cstdio>
+
+// Hardware performance counters (cycles, instructions, cache misses, branch misses) read
+// around each frame phase through perf_event_open. Linux only; elsewhere open() fails and
+// everything else is a no-op.
+
+enum HwPhase { HW_EVENTS, HW_UPDATE, HW_RENDER, HW_PHASE_COUNT };
+
+enum HwCounter { HW_CYCLES, HW_INSTRUCTIONS, HW_CACHE_MISSES, HW_BRANCH_MISSES, HW_COUNTER_COUNT };
+
+struct HwPhaseTotals {
+    uint64_t values[HW_COUNTER_COUNT];
+    uint64_t samples;
+
+    double ipc() const;
+    double cacheMissesPerKiloInstr() const;
+    double branchMissesPerKiloInstr() const;
+};
+
+class HwCounters {
+public:
+    HwCounters();
+    ~HwCounters();
+    bool open(const char* csvPath);
+    void close();
+    bool active() const { return leader >= 0; }
+
+    void begin();
+    void end(HwPhase phase);
+    void endFrame(uint64_t frameNs);   // writes one CSV row per frame
+    const HwPhaseTotals& totals(HwPhase phase) const { return phaseTotals[phase]; }
+    void printSummary() const;
+
+private:
+    bool read(uint64_t* values);
+
+    int leader;
+    int fds[HW_COUNTER_COUNT];
+    uint64_t started[HW_COUNTER_COUNT];
+    uint64_t frame[HW_PHASE_COUNT][HW_COUNTER_COUNT];
+    HwPhaseTotals phaseTotals[HW_PHASE_COUNT];
+    uint64_t frames;
+    FILE* csv;
+};
+
+// Counts the enclosing scope as one phase when the counters are active
+class HwPhaseScope {
+public:
+    HwPhaseScope(HwCounters& counters, HwPhase phase) : counters(counters), phase(phase) {
+        if (counters.active()) counters.begin();
+    }
+    ~HwPhaseScope() {
+        if (counters.active()) counters.end(phase);
+    }
+
+private:
+    HwCounters& counters;
+    HwPhase phase;
+};
+
+#endif
@@ -0,0 +1,274 @@
+#include "log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+static const chrono::steady_clock::time_point logEpoch = chrono::steady_clock::now();
+
+static uint64_t logNowNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - logEpoch).count();
+}
+
+LogBuilder::LogBuilder(int level, const char* format, int suppressed) : textUsed(0) {
+    record.timeNs = logNowNs();
+    record.level = level;
+    record.format = format;
+    record.argCount = 0;
+    record.suppressed = suppressed;
+}
+
+LogArg& LogBuilder::push(LogArg::Type type) {
+    static LogArg overflow;
+    if (record.argCount == LOG_MAX_ARGS) {
+        return overflow;//extra arguments are dropped, their conversions print as-is
+    }
+    LogArg& arg = record.args[record.argCount++];
+    arg.type = type;
+    return arg;
+}
+
+// Strings are copied, the caller's buffer may not outlive the call (SDL_GetError()). Once
+// the text is full, further strings are the empty string in its last byte.
+void LogBuilder::add(const char* s) {
+    LogArg& arg = push(LogArg::STRING);
+    if (s == nullptr) {
+        s = "(null)";
+    }
+    int room = LOG_TEXT_BYTES - textUsed - 1;
+    int length = static_cast<int>(strnlen(s, room));
+    arg.offset = textUsed;
+    memcpy(record.text + textUsed, s, length);
+    record.text[textUsed + length] = '\0';
+    textUsed = min(textUsed + length + 1, LOG_TEXT_BYTES - 1);
+}
+
+bool LogRateLimit::allow(int& suppressedBefore) {
+    int64_t second = static_cast<int64_t>(logNowNs() / 1000000000ull);
+    int64_t window = windowStart.load(memory_order_relaxed);
+    if (second != window && windowStart.compare_exchange_strong(window, second)) {
+        count = 0;
+        suppressedBefore = suppressed.exchange(0);
+    }
+    if (count.fetch_add(1, memory_order_relaxed) < LOG_RATE_LIMIT) {
+        return true;
+    }
+    suppressed.fetch_add(1, memory_order_relaxed);
+    return false;
+}
+
+// Bounded multi-producer queue (Vyukov): each slot's sequence number says whether it is
+// free for the producer at that position or holds a record for the consumer.
+struct LogSlot {
+    atomic<size_t> sequence;
+    LogRecord record;
+};
+
+class Logger {
+public:
+    Logger();
+    ~Logger();
+    bool push(const LogRecord& record);
+    void flush();
+    uint64_t dropped() const { return droppedCount.load(); }
+
+private:
+    void start();
+    void run();
+    bool drain();
+    void write(const LogRecord& record);
+
+    LogSlot slots[LOG_RING_SIZE];
+    atomic<size_t> enqueuePos;
+    size_t dequeuePos;
+    atomic<size_t> writtenPos;
+    atomic<uint64_t> droppedCount;
+    atomic<bool> running;
+    once_flag started;
+    thread writer;
+};
+
+Logger::Logger() : enqueuePos(0), dequeuePos(0), writtenPos(0), droppedCount(0), running(false) {
+    for (size_t i = 0; i < LOG_RING_SIZE; ++i) {
+        slots[i].sequence.store(i, memory_order_relaxed);
+    }
+}
+
+Logger::~Logger() {
+    if (running.exchange(false)) {
+        writer.join();
+    }
+}
+
+void Logger::start() {
+    running = true;
+    writer = thread(&Logger::run, this);
+}
+
+bool Logger::push(const LogRecord& record) {
+    call_once(started, &Logger::start, this);
+
+    size_t pos = enqueuePos.load(memory_order_relaxed);
+    for (;;) {
+        LogSlot& slot = slots[pos & (LOG_RING_SIZE - 1)];
+        size_t sequence = slot.sequence.load(memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                slot.record = record;
+                slot.sequence.store(pos + 1, memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            droppedCount.fetch_add(1, memory_order_relaxed);//full, never block the caller
+            return false;
+        } else {
+            pos = enqueuePos.load(memory_order_relaxed);
+        }
+    }
+}
+
+bool Logger::drain() {
+    bool any = false;
+    for (;;) {
+        LogSlot& slot = slots[dequeuePos & (LOG_RING_SIZE - 1)];
+        if (slot.sequence.load(memory_order_acquire) != dequeuePos + 1) {
+            break;
+        }
+        write(slot.record);
+        slot.sequence.store(dequeuePos + LOG_RING_SIZE, memory_order_release);
+        dequeuePos++;
+        any = true;
+    }
+    if (any) {
+        fflush(stdout);
+        writtenPos.store(dequeuePos, memory_order_release);
+    }
+    return any;
+}
+
+void Logger::run() {
+    while (running.load()) {
+        if (!drain()) {
+            this_thread::sleep_for(chrono::milliseconds(2));
+        }
+    }
+    drain();
+}
+
+void Logger::flush() {
+    size_t target = enqueuePos.load();
+    while (running.load() && writtenPos.load(memory_order_acquire) < target) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+static const int LOG_LINE_BYTES = 1024;
+
+static const char* LEVEL_NAMES[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR" };
+
+static bool isConversion(char c) {
+    return strchr("diuxXcsfgep", c) != nullptr;
+}
+
+// Where a line stands after snprintf() wrote to it at used: one short of the end at most,
+// to leave room for the newline, however much the output was truncated
+static int append(int used, int written) {
+    return written < 0 ? used : min(used + written, LOG_LINE_BYTES - 1);
+}
+
+void Logger::write(const LogRecord& record) {
+    char line[LOG_LINE_BYTES];
+    int used = append(0, snprintf(line, sizeof(line), "[%10.3f] %-5s ", record.timeNs / 1e9,
+                                  LEVEL_NAMES[record.level < 0 || record.level > 4 ? 0 : record.level]));
+
+    int next = 0;
+    const char* f = record.format;
+    while (*f != '\0' && used < LOG_LINE_BYTES - 1) {
+        if (*f != '%') {
+            line[used++] = *f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            line[used++] = '%';
+            f += 2;
+            continue;
+        }
+
+        //Rebuild the conversion with the length modifier matching how the argument was stored
+        char spec[32];
+        int n = 0;
+        const char* start = f++;
+        while (*f != '\0' && !isConversion(*f) && n < 20) {
+            if (strchr("hlLqjzt", *f) == nullptr) {
+                spec[n++] = *f;
+            }
+            f++;
+        }
+        if (*f == '\0' || next >= record.argCount) {
+            int length = static_cast<int>(f - start);
+            used = append(used, snprintf(line + used, sizeof(line) - used, "%.*s", length, start));
+            continue;
+        }
+        char conversion = *f++;
+        const LogArg& arg = record.args[next++];
+
+        char format[40];
+        int room = sizeof(line) - used;
+        switch (arg.type) {
+            case LogArg::INT:
+            case LogArg::UINT:
+                if (conversion == 'c') {
+                    snprintf(format, sizeof(format), "%%%.*sc", n, spec);
+                    used = append(used, snprintf(line + used, room, format, static_cast<int>(arg.i)));
+                } else if (strchr("fge", conversion) != nullptr) {
+                    snprintf(format, sizeof(format), "%%%.*s%c", n, spec, conversion);
+                    double value = arg.type == LogArg::INT ? static_cast<double>(arg.i) : static_cast<double>(arg.u);
+                    used = append(used, snprintf(line + used, room, format, value));
+                } else if (arg.type == LogArg::INT && (conversion == 'd' || conversion == 'i')) {
+                    snprintf(format, sizeof(format), "%%%.*slld", n, spec);
+                    used = append(used, snprintf(line + used, room, format, arg.i));
+                } else {
+                    char c = conversion == 'x' || conversion == 'X' ? conversion : 'u';
+                    snprintf(format, sizeof(format), "%%%.*sll%c", n, spec, c);
+                    used = append(used, snprintf(line + used, room, format, arg.u));
+                }
+                break;
+            case LogArg::DOUBLE:
+                snprintf(format, sizeof(format), "%%%.*s%c", n, spec, strchr("fge", conversion) ? conversion : 'g');
+                used = append(used, snprintf(line + used, room, format, arg.d));
+                break;
+            case LogArg::STRING:
+                snprintf(format, sizeof(format), "%%%.*ss", n, spec);
+                used = append(used, snprintf(line + used, room, format, record.text + arg.offset));
+                break;
+            case LogArg::POINTER:
+                used = append(used, snprintf(line + used, room, "%p", arg.p));
+                break;
+        }
+    }
+
+    if (record.suppressed > 0 && used < LOG_LINE_BYTES - 1) {
+        used = append(used, snprintf(line + used, sizeof(line) - used, " (%d similar suppressed)", record.suppressed));
+    }
+    line[used++] = '\n';
+    fwrite(line, 1, used, stdout);
+}
+
+static Logger logger;
+
+void logSubmit(const LogRecord& record) {
+    logger.push(record);
+}
+
+void logFlush() {
+    logger.flush();
+}
+
+uint64_t logDropped() {
+    return logger.dropped();
+}
@@ -0,0 +1,125 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Asynchronous logger. A log call copies its format pointer and arguments into a slot of a
+// lock-free multi-producer ring and returns; a background thread formats and writes the
+// records. Calls below SNAKE_LOG_LEVEL compile to nothing, and each call site is rate
+// limited to LOG_RATE_LIMIT records per second (the rest are counted and reported).
+//
+//   LOG_ERROR("Failed to load image: %s", IMG_GetError());
+//
+// Supported conversions: d i u x X c s f g e p and %%, with flags, width and precision.
+
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_WARN  3
+#define LOG_LEVEL_ERROR 4
+
+#ifndef SNAKE_LOG_LEVEL
+#define SNAKE_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+const int LOG_RING_SIZE = 4096;        // records, power of two
+const int LOG_MAX_ARGS = 6;
+const int LOG_TEXT_BYTES = 192;        // room for copied string arguments
+const int LOG_RATE_LIMIT = 20;         // per call site per second
+
+struct LogArg {
+    enum Type { INT, UINT, DOUBLE, STRING, POINTER } type;
+    union {
+        long long i;
+        unsigned long long u;
+        double d;
+        int offset;                    // STRING, into LogRecord::text
+        const void* p;
+    };
+};
+
+struct LogRecord {
+    uint64_t timeNs;
+    int level;
+    const char* format;
+    int argCount;
+    int suppressed;
+    LogArg args[LOG_MAX_ARGS];
+    char text[LOG_TEXT_BYTES];
+};
+
+// Builds a record on the caller's stack, then logSubmit() copies it into the ring
+class LogBuilder {
+public:
+    LogBuilder(int level, const char* format, int suppressed);
+    void add(long long v) { push(LogArg::INT).i = v; }
+    void add(unsigned long long v) { push(LogArg::UINT).u = v; }
+    void add(int v) { add(static_cast<long long>(v)); }
+    void add(long v) { add(static_cast<long long>(v)); }
+    void add(unsigned int v) { add(static_cast<unsigned long long>(v)); }
+    void add(unsigned long v) { add(static_cast<unsigned long long>(v)); }
+    void add(char v) { add(static_cast<long long>(v)); }
+    void add(bool v) { add(static_cast<long long>(v)); }
+    void add(double v) { push(LogArg::DOUBLE).d = v; }
+    void add(float v) { add(static_cast<double>(v)); }
+    void add(const char* s);
+    void add(const std::string& s) { add(s.c_str()); }
+    void add(const void* p) { push(LogArg::POINTER).p = p; }
+
+    LogRecord record;
+
+private:
+    LogArg& push(LogArg::Type type);
+    int textUsed;
+};
+
+void logSubmit(const LogRecord& record);
+void logFlush();                       // blocks until everything queued so far is written
+uint64_t logDropped();
+
+inline void logAddArgs(LogBuilder&) {}
+
+template <typename T, typename... Rest>
+inline void logAddArgs(LogBuilder& builder, const T& first, const Rest&... rest) {
+    builder.add(first);
+    logAddArgs(builder, rest...);
+}
+
+template <typename... Args>
+inline void logEmit(int level, int suppressed, const char* format, const Args&... args) {
+    LogBuilder builder(level, format, suppressed);
+    logAddArgs(builder, args...);
+    logSubmit(builder.record);
+}
+
+class LogRateLimit {
+public:
+    LogRateLimit() : windowStart(0), count(0), suppressed(0) {}
+    bool allow(int& suppressedBefore);
+
+private:
+    std::atomic<int64_t> windowStart;
+    std::atomic<int> count;
+    std::atomic<int> suppressed;
+};
+
+#define LOG_AT(level, ...)                                                  \
+    do {                                                                    \
+        if ((level) >= SNAKE_LOG_LEVEL) {                                   \
+            static LogRateLimit logLimit;                                   \
+            int logSuppressed = 0;                                          \
+            if (logLimit.allow(logSuppressed)) {                            \
+                logEmit((level), logSuppressed, __VA_ARGS__);               \
+            }                                                               \
+        }                                                                   \
+    } while (0)
+
+#define LOG_TRACE(...) LOG_AT(LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)  LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif
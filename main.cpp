@@ -0,0 +1,78 @@
+#include "game.h"
+#include "profiler.h"
+#include "log.h"
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+int main(int argc, char* args[]) {
+    GameOptions options;
+    const char* replayPath = nullptr;
+    bool resume = false;
+    for (int i = 1; i < argc; ++i) {
+        if (string(args[i]) == "--audio-buffer" && i + 1 < argc) {
+            int size = atoi(args[++i]);//smaller is lower latency, larger is safer against underruns
+            if (size >= MIN_AUDIO_BUFFER && size <= MAX_AUDIO_BUFFER && (size & (size - 1)) == 0) {
+                options.audioBufferSize = size;
+            } else {
+                LOG_WARN("--audio-buffer %s is not a power of two from %d to %d, using %d", args[i], MIN_AUDIO_BUFFER,
+                         MAX_AUDIO_BUFFER, DEFAULT_AUDIO_BUFFER);
+            }
+        } else if (string(args[i]) == "--vram-budget" && i + 1 < argc) {
+            options.textureBudget = static_cast<size_t>(atoi(args[++i])) * 1024 * 1024;//MB
+        } else if (string(args[i]) == "--hw-counters" && i + 1 < argc) {
+            options.hwCountersPath = args[++i];
+        } else if (string(args[i]) == "--tick-rate" && i + 1 < argc) {
+            options.tickRate = max(1, atoi(args[++i]));
+        } else if (string(args[i]) == "--watchdog") {
+            options.watchdogPrefix = "flight";
+        } else if (string(args[i]) == "--metrics-port" && i + 1 < argc) {
+            options.metricsPort = atoi(args[++i]);
+        } else if (string(args[i]) == "--metrics-file" && i + 1 < argc) {
+            options.metricsFile = args[++i];
+        } else if (string(args[i]) == "--seed" && i + 1 < argc) {
+            options.seed = strtoull(args[++i], nullptr, 10);//replay a game shown on the game over screen
+        } else if (string(args[i]) == "--replay" && i + 1 < argc) {
+            replayPath = args[++i];
+            options.replayPrefix = nullptr;
+        } else if (string(args[i]) == "--keyframes" && i + 1 < argc) {
+            options.keyframeInterval = max(0, atoi(args[++i]));//ticks, lets the replay viewer seek
+        } else if (string(args[i]) == "--hashes" && i + 1 < argc) {
+            options.hashInterval = max(0, atoi(args[++i]));//ticks, lets verify find where a replay desyncs
+        } else if (string(args[i]) == "--no-replays") {
+            options.replayPrefix = nullptr;
+        } else if (string(args[i]) == "--speed" && i + 1 < argc) {
+            options.speed = atoi(args[++i]);//sim ticks per frame, for demos and bot matches
+        } else if (string(args[i]) == "--autopilot") {
+            options.autopilot = AUTOPILOT_PATH;//attract mode, or with --speed a load generator
+        } else if (string(args[i]) == "--hamilton") {
+            options.autopilot = AUTOPILOT_CYCLE;//the bot that follows a Hamiltonian cycle, slower but it fills the board
+        } else if (string(args[i]) == "--resume") {
+            resume = true;//straight back into the game saved from the pause screen
+        }
+    }
+
+    int result = 0;
+    {
+        SnakeGame game(options);
+        if (!game.init()) {
+            LOG_ERROR("Failed to initialize!");
+            logFlush();
+            return -1;
+        }
+        if (replayPath != nullptr) {
+            result = game.playReplay(replayPath) ? 0 : 1;
+        } else if (resume && game.restore(options.snapshotPath)) {
+            game.run();
+        } else {
+            game.menu();
+        }
+    }
+
+    PROFILE_DUMP(PROFILE_TRACE_FILE);
+    resourceReport();
+    logFlush();
+    return result;
+}
@@ -0,0 +1,279 @@
+#include "metrics.h"
+#include "log.h"
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#include <psapi.h>
+typedef SOCKET SocketHandle;
+#define closeSocket closesocket
+#define MSG_NOSIGNAL 0
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int SocketHandle;
+#define closeSocket ::close
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0          // macOS, which uses SO_NOSIGPIPE on the socket instead
+#endif
+#endif
+
+using namespace std;
+
+static const double TICK_BOUNDS_SECONDS[TICK_BUCKET_COUNT] = {
+    0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5,
+};
+
+static const int SCORE_BOUNDS[SCORE_BUCKET_COUNT] = { 0, 10, 50, 100, 200, 500, 1000, 2000 };
+
+GameMetrics::GameMetrics()
+    : framesRendered(0), tickSumNs(0), scoreSum(0), liveTextures(0), liveTextureBytes(0) {
+    for (auto& bucket : tickBuckets) bucket = 0;
+    for (auto& games : gamesPlayed) games = 0;
+    for (auto& bucket : scoreBuckets) bucket = 0;
+}
+
+void GameMetrics::recordTick(uint64_t ns) {
+    int bucket = 0;
+    while (bucket < TICK_BUCKET_COUNT && ns > TICK_BOUNDS_SECONDS[bucket] * 1e9) {
+        bucket++;
+    }
+    tickBuckets[bucket].fetch_add(1, memory_order_relaxed);
+    tickSumNs.fetch_add(ns, memory_order_relaxed);
+}
+
+void GameMetrics::recordGame(int level, int score) {
+    if (level >= 1 && level <= METRICS_LEVELS) {
+        gamesPlayed[level - 1].fetch_add(1, memory_order_relaxed);
+    }
+    int bucket = 0;
+    while (bucket < SCORE_BUCKET_COUNT && score > SCORE_BOUNDS[bucket]) {
+        bucket++;
+    }
+    scoreBuckets[bucket].fetch_add(1, memory_order_relaxed);
+    scoreSum.fetch_add(score, memory_order_relaxed);
+}
+
+void GameMetrics::setLiveTextures(int count, long long bytes) {
+    liveTextures.store(count, memory_order_relaxed);
+    liveTextureBytes.store(bytes, memory_order_relaxed);
+}
+
+string GameMetrics::format() const {
+    ostringstream out;
+    out << "# HELP snake_frames_rendered_total Frames rendered.\n"
+        << "# TYPE snake_frames_rendered_total counter\n"
+        << "snake_frames_rendered_total " << framesRendered.load() << "\n";
+
+    out << "# HELP snake_tick_seconds Time to process and render one tick.\n"
+        << "# TYPE snake_tick_seconds histogram\n";
+    uint64_t cumulative = 0;
+    for (int i = 0; i < TICK_BUCKET_COUNT; ++i) {
+        cumulative += tickBuckets[i].load();
+        out << "snake_tick_seconds_bucket{le=\"" << TICK_BOUNDS_SECONDS[i] << "\"} " << cumulative << "\n";
+    }
+    cumulative += tickBuckets[TICK_BUCKET_COUNT].load();
+    out << "snake_tick_seconds_bucket{le=\"+Inf\"} " << cumulative << "\n"
+        << "snake_tick_seconds_sum " << tickSumNs.load() / 1e9 << "\n"
+        << "snake_tick_seconds_count " << cumulative << "\n";
+
+    out << "# HELP snake_games_played_total Games finished, by level.\n"
+        << "# TYPE snake_games_played_total counter\n";
+    for (int i = 0; i < METRICS_LEVELS; ++i) {
+        out << "snake_games_played_total{level=\"" << i + 1 << "\"} " << gamesPlayed[i].load() << "\n";
+    }
+
+    out << "# HELP snake_score Final score of finished games.\n"
+        << "# TYPE snake_score histogram\n";
+    cumulative = 0;
+    for (int i = 0; i < SCORE_BUCKET_COUNT; ++i) {
+        cumulative += scoreBuckets[i].load();
+        out << "snake_score_bucket{le=\"" << SCORE_BOUNDS[i] << "\"} " << cumulative << "\n";
+    }
+    cumulative += scoreBuckets[SCORE_BUCKET_COUNT].load();
+    out << "snake_score_bucket{le=\"+Inf\"} " << cumulative << "\n"
+        << "snake_score_sum " << scoreSum.load() << "\n"
+        << "snake_score_count " << cumulative << "\n";
+
+    out << "# HELP snake_live_textures Textures currently allocated.\n"
+        << "# TYPE snake_live_textures gauge\n"
+        << "snake_live_textures " << liveTextures.load() << "\n"
+        << "# HELP snake_live_texture_bytes Estimated bytes of live textures.\n"
+        << "# TYPE snake_live_texture_bytes gauge\n"
+        << "snake_live_texture_bytes " << liveTextureBytes.load() << "\n"
+        << "# HELP snake_resident_memory_bytes Resident set size of the process.\n"
+        << "# TYPE snake_resident_memory_bytes gauge\n"
+        << "snake_resident_memory_bytes " << residentMemoryBytes() << "\n";
+    return out.str();
+}
+
+long long residentMemoryBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<long long>(counters.WorkingSetSize);
+    }
+    return 0;
+#else
+    long long pages = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == nullptr) {
+        return 0;
+    }
+    if (fscanf(statm, "%lld %lld", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(statm);
+    return resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+MetricsExporter::MetricsExporter(const GameMetrics& metrics)
+    : metrics(metrics), running(false), listener(-1) {}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+bool MetricsExporter::startHttp(int port) {
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        return false;
+    }
+#endif
+    SocketHandle s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == static_cast<SocketHandle>(-1)) {
+        LOG_ERROR("Metrics: could not create socket");
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<unsigned short>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);//never exposed beyond this machine
+    if (bind(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(s, 4) != 0) {
+        LOG_ERROR("Metrics: could not listen on 127.0.0.1:%d", port);
+        closeSocket(s);
+        return false;
+    }
+
+    listener = static_cast<long long>(s);
+    running = true;
+    thread = std::thread(&MetricsExporter::serve, this);
+    LOG_INFO("Metrics: serving http://127.0.0.1:%d/metrics", port);
+    return true;
+}
+
+bool MetricsExporter::startFile(const char* filePath) {
+    path = filePath;
+    running = true;
+    thread = std::thread(&MetricsExporter::writeFile, this);
+    return true;
+}
+
+void MetricsExporter::stop() {
+    {
+        lock_guard<mutex> lock(wakeMutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    wake.notify_one();
+    thread.join();
+    if (listener != -1) {
+        closeSocket(static_cast<SocketHandle>(listener));
+        listener = -1;
+    }
+}
+
+// A scraper that hangs up mid-response must not raise SIGPIPE, which would end the game
+static void sendAll(SocketHandle client, const string& data) {
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int n = send(client, data.data() + sent, static_cast<int>(data.size() - sent), MSG_NOSIGNAL);
+        if (n <= 0) {
+            return;
+        }
+        sent += n;
+    }
+}
+
+// Every request gets the metrics page, whatever its path
+void MetricsExporter::serve() {
+    SocketHandle s = static_cast<SocketHandle>(listener);
+    for (;;) {
+        {
+            lock_guard<mutex> lock(wakeMutex);
+            if (!running) {
+                return;
+            }
+        }
+
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(s, &readable);
+        timeval timeout = { 0, 200000 };
+        if (select(static_cast<int>(s) + 1, &readable, nullptr, nullptr, &timeout) <= 0) {
+            continue;
+        }
+
+        SocketHandle client = accept(s, nullptr, nullptr);
+        if (client == static_cast<SocketHandle>(-1)) {
+            continue;
+        }
+
+        char request[1024];
+        FD_ZERO(&readable);
+        FD_SET(client, &readable);
+        timeval readTimeout = { 1, 0 };
+        if (select(static_cast<int>(client) + 1, &readable, nullptr, nullptr, &readTimeout) > 0) {
+            recv(client, request, sizeof(request), 0);
+        }
+
+        string body = metrics.format();
+        string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+                          + to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        sendAll(client, response);
+        closeSocket(client);
+    }
+}
+
+// Scrapers reading the file see the old text or the new, never a gap where it's missing
+static void replaceFile(const string& from, const string& to) {
+#ifdef _WIN32
+    MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+    rename(from.c_str(), to.c_str());
+#endif
+}
+
+void MetricsExporter::writeFile() {
+    string temporary = path + ".tmp";
+    unique_lock<mutex> lock(wakeMutex);
+    while (running) {
+        lock.unlock();
+        string body = metrics.format();
+        FILE* file = fopen(temporary.c_str(), "w");
+        if (file != nullptr) {
+            fwrite(body.data(), 1, body.size(), file);
+            fclose(file);
+            replaceFile(temporary, path);
+        }
+        lock.lock();
+        wake.wait_for(lock, chrono::milliseconds(METRICS_FILE_INTERVAL_MS));
+    }
+}
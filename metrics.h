@@ -0,0 +1,63 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Counters for long-running instances, exported in Prometheus text format either over
+// HTTP on 127.0.0.1 or by rewriting a file periodically. The game loop only does relaxed
+// atomic increments; formatting and I/O happen on the exporter thread.
+
+const int TICK_BUCKET_COUNT = 10;
+const int SCORE_BUCKET_COUNT = 8;
+const int METRICS_LEVELS = 3;
+const int METRICS_FILE_INTERVAL_MS = 10000;
+
+class GameMetrics {
+public:
+    GameMetrics();
+    void recordTick(uint64_t ns);
+    void recordFrame() { framesRendered.fetch_add(1, std::memory_order_relaxed); }
+    void recordGame(int level, int score);
+    void setLiveTextures(int count, long long bytes);
+    std::string format() const;
+
+private:
+    std::atomic<uint64_t> framesRendered;
+    std::atomic<uint64_t> tickBuckets[TICK_BUCKET_COUNT + 1];   // last one is +Inf
+    std::atomic<uint64_t> tickSumNs;
+    std::atomic<uint64_t> gamesPlayed[METRICS_LEVELS];
+    std::atomic<uint64_t> scoreBuckets[SCORE_BUCKET_COUNT + 1];
+    std::atomic<uint64_t> scoreSum;
+    std::atomic<int> liveTextures;
+    std::atomic<long long> liveTextureBytes;
+};
+
+class MetricsExporter {
+public:
+    MetricsExporter(const GameMetrics& metrics);
+    ~MetricsExporter();
+    bool startHttp(int port);
+    bool startFile(const char* path);
+    void stop();
+
+private:
+    void serve();
+    void writeFile();
+
+    const GameMetrics& metrics;
+    std::thread thread;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool running;
+    long long listener;   // socket handle, -1 when closed
+    std::string path;
+};
+
+long long residentMemoryBytes();
+
+#endif
@@ -0,0 +1,104 @@
+#include "perfstats.h"
+#include "alloc.h"
+#include "resources.h"
+
+FrameCounters frameCounters;
+
+LogHistogram::LogHistogram() {
+    reset();
+}
+
+void LogHistogram::reset() {
+    for (int i = 0; i < BUCKETS; ++i) {
+        counts[i] = 0;
+    }
+    total = 0;
+    sum = 0;
+    minValue = 0;
+    maxValue = 0;
+}
+
+int LogHistogram::bucketFor(uint64_t value) {
+    if (value < SUB_COUNT) {
+        return static_cast<int>(value);
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent > 47) {
+        return BUCKETS - 1;
+    }
+    int sub = static_cast<int>((value >> (exponent - SUB_BITS)) & (SUB_COUNT - 1));
+    return (exponent - SUB_BITS + 1) * SUB_COUNT + sub;
+}
+
+uint64_t LogHistogram::bucketLow(int bucket) {
+    if (bucket < SUB_COUNT) {
+        return bucket;
+    }
+    int exponent = bucket / SUB_COUNT + SUB_BITS - 1;
+    uint64_t sub = bucket % SUB_COUNT;
+    return (SUB_COUNT + sub) << (exponent - SUB_BITS);
+}
+
+uint64_t LogHistogram::bucketHigh(int bucket) {
+    if (bucket < SUB_COUNT) {
+        return bucket;
+    }
+    int exponent = bucket / SUB_COUNT + SUB_BITS - 1;
+    return bucketLow(bucket) + (1ull << (exponent - SUB_BITS)) - 1;
+}
+
+void LogHistogram::record(uint64_t value) {
+    counts[bucketFor(value)]++;
+    if (total == 0 || value < minValue) minValue = value;
+    if (value > maxValue) maxValue = value;
+    total++;
+    sum += value;
+}
+
+uint64_t LogHistogram::percentile(double p) const {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint64_t mid = bucketLow(i) + (bucketHigh(i) - bucketLow(i)) / 2;
+            return mid > maxValue ? maxValue : mid;
+        }
+    }
+    return maxValue;
+}
+
+FrameStats::FrameStats()
+    : lastFrameNs(0), lastTickNs(0), overlayNs(0), historyPos(0),
+      uploadsBefore(0), allocationsBefore(0) {
+    last = { 0, 0, 0 };
+    frameCounters = { 0, 0, 0 };
+    for (int i = 0; i < FRAME_HISTORY; ++i) {
+        history[i] = 0.0f;
+    }
+}
+
+void FrameStats::recordTick(uint64_t ns) {
+    lastTickNs = ns;
+    tickTimes.record(ns);
+}
+
+void FrameStats::endFrame(uint64_t frameNs) {
+    lastFrameNs = frameNs;
+    frameTimes.record(frameNs);
+    history[historyPos] = frameNs / 1e6f;
+    historyPos = (historyPos + 1) % FRAME_HISTORY;
+
+    long long uploads = resourceCounters[RES_TEXTURE].created;
+    long long allocations = allocationCount();
+    frameCounters.textureUploads = static_cast<int>(uploads - uploadsBefore);
+    frameCounters.allocations = allocations - allocationsBefore;
+    uploadsBefore = uploads;
+    allocationsBefore = allocations;
+
+    last = frameCounters;
+    frameCounters = { 0, 0, 0 };
+}
@@ -0,0 +1,68 @@
+#ifndef PERFSTATS_H
+#define PERFSTATS_H
+
+#include <cstdint>
+
+// Log-bucketed histogram in the style of HdrHistogram: every power of two is split into
+// 16 linear sub-buckets, so any value up to ~2^47 is kept within ~6% using a fixed 5.6 KB.
+class LogHistogram {
+public:
+    static const int SUB_BITS = 4;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int BUCKETS = (48 - SUB_BITS + 1) * SUB_COUNT;
+
+    LogHistogram();
+    void record(uint64_t value);
+    void reset();
+    uint64_t percentile(double p) const;   // p in [0, 1]
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxValue; }
+    uint64_t min() const { return total ? minValue : 0; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+
+    static int bucketFor(uint64_t value);
+    static uint64_t bucketLow(int bucket);
+    static uint64_t bucketHigh(int bucket);
+    uint64_t bucketCount(int bucket) const { return counts[bucket]; }
+
+private:
+    uint64_t counts[BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t minValue;
+    uint64_t maxValue;
+};
+
+const int FRAME_HISTORY = 120;   // frames shown in the overlay graph
+
+// Per-frame work counters, reset at the end of every frame
+struct FrameCounters {
+    int drawCalls;
+    int textureUploads;
+    long long allocations;
+};
+
+extern FrameCounters frameCounters;
+
+// Everything the performance overlay shows
+class FrameStats {
+public:
+    FrameStats();
+    void recordTick(uint64_t ns);
+    void endFrame(uint64_t frameNs);
+
+    LogHistogram frameTimes;
+    LogHistogram tickTimes;
+    uint64_t lastFrameNs;
+    uint64_t lastTickNs;
+    uint64_t overlayNs;
+    FrameCounters last;
+    float history[FRAME_HISTORY];   // ms, ring indexed by historyPos
+    int historyPos;
+
+private:
+    long long uploadsBefore;
+    long long allocationsBefore;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include "profiler.h"
+
+#ifdef SNAKE_PROFILE
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+struct ProfileEvent {
+    const char* name;
+    long long startNs;
+    long long endNs;
+};
+
+struct ProfileRing {
+    int threadId;
+    atomic<unsigned long long> written;
+    ProfileEvent events[PROFILE_RING_SIZE];
+};
+
+static mutex ringsMutex;
+static vector<ProfileRing*> rings;   // never freed, threads may still be writing at exit
+static const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+
+static ProfileRing* threadRing() {
+    thread_local ProfileRing* ring = nullptr;
+    if (ring == nullptr) {
+        ring = new ProfileRing();
+        ring->written = 0;
+        lock_guard<mutex> lock(ringsMutex);
+        ring->threadId = static_cast<int>(rings.size()) + 1;
+        rings.push_back(ring);
+    }
+    return ring;
+}
+
+void profilerRecord(const char* name, chrono::steady_clock::time_point start,
+                    chrono::steady_clock::time_point end) {
+    ProfileRing* ring = threadRing();
+    unsigned long long n = ring->written.load(memory_order_relaxed);
+    ProfileEvent& event = ring->events[n % PROFILE_RING_SIZE];
+    event.name = name;
+    event.startNs = chrono::duration_cast<chrono::nanoseconds>(start - epoch).count();
+    event.endNs = chrono::duration_cast<chrono::nanoseconds>(end - epoch).count();
+    ring->written.store(n + 1, memory_order_release);
+}
+
+bool profilerDump(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    lock_guard<mutex> lock(ringsMutex);
+    for (ProfileRing* ring : rings) {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", ring->threadId, ring->threadId == 1 ? "main" : "worker");
+        first = false;
+
+        unsigned long long written = ring->written.load(memory_order_acquire);
+        unsigned long long begin = written > PROFILE_RING_SIZE ? written - PROFILE_RING_SIZE : 0;
+        for (unsigned long long i = begin; i < written; ++i) {
+            const ProfileEvent& event = ring->events[i % PROFILE_RING_SIZE];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    event.name, ring->threadId, event.startNs / 1000.0, (event.endNs - event.startNs) / 1000.0);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return true;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Scoped-zone profiler. Build with -DSNAKE_PROFILE to record zones; otherwise the
+// macros compile to nothing. Each thread records into its own fixed-size ring buffer and
+// profilerDump() writes everything still in the rings as Chrome trace-event JSON
+// (open it in chrome://tracing or Perfetto).
+
+#ifdef SNAKE_PROFILE
+
+#include <chrono>
+
+const int PROFILE_RING_SIZE = 1 << 16;   // events kept per thread
+
+void profilerRecord(const char* name, std::chrono::steady_clock::time_point start,
+                    std::chrono::steady_clock::time_point end);
+bool profilerDump(const char* path);
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : name(name), start(std::chrono::steady_clock::now()) {}
+    ~ProfileZone() { profilerRecord(name, start, std::chrono::steady_clock::now()); }
+
+private:
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_DUMP(path) profilerDump(path)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_DUMP(path) ((void)0)
+
+#endif
+
+const char* const PROFILE_TRACE_FILE = "snake_trace.json";
+
+#endif
@@ -0,0 +1,284 @@
+#include "game.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+// Headless performance regression runner. Plays a scripted session on each level with
+// the dummy drivers and a software renderer, then compares update/render timings with
+// a baseline file and exits non-zero if any metric got slower than the tolerance allows.
+// The first run on a machine, with no baseline yet, records one instead.
+// With --determinism it instead plays every session twice and fails unless the game
+// state matches tick by tick and the incremental state hash matches one from scratch.
+
+const char* const DEFAULT_BASELINE = "perf_baseline.txt";
+
+class GameRunner {
+public:
+    GameRunner(SnakeGame& game) : hashDrift(0), game(game) {}
+    void play(int level, unsigned int seed, int ticks, vector<double>& updateNs, vector<double>& renderNs);
+    void trace(int level, unsigned int seed, int ticks, vector<uint64_t>& states);
+
+    int hashDrift;          // ticks traced where Simulation::hash was wrong
+
+private:
+    void start(int level, unsigned int seed);
+    void input(unsigned int& lcg);
+    void pressKey(SDL_Keycode key);
+    uint64_t stateHash() const;
+
+    SnakeGame& game;
+};
+
+void GameRunner::pressKey(SDL_Keycode key) {
+    SDL_Event e;
+    SDL_zero(e);
+    e.type = SDL_KEYDOWN;
+    e.key.keysym.sym = key;
+    SDL_PushEvent(&e);
+}
+
+void GameRunner::start(int level, unsigned int seed) {
+    SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+    game.sim.level2 = level >= 2;
+    game.sim.level3 = level >= 3;
+    game.reset(seed);
+}
+
+// The input stream is a fixed LCG so every run sees the same key presses
+void GameRunner::input(unsigned int& lcg) {
+    const SDL_Keycode keys[] = { SDLK_UP, SDLK_RIGHT, SDLK_DOWN, SDLK_LEFT };
+    lcg = lcg * 1103515245u + 12345u;
+    if ((lcg >> 16) % 6 == 0) {
+        pressKey(keys[(lcg >> 20) % 4]);
+    }
+    game.handleEvents();
+}
+
+// FNV-1a over everything update() reads or writes
+uint64_t GameRunner::stateHash() const {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto add = [&hash](int value) {
+        for (int i = 0; i < 4; ++i) {
+            hash = (hash ^ ((value >> (i * 8)) & 0xff)) * 0x100000001b3ull;
+        }
+    };
+    auto addBody = [&add](const auto& body) {
+        add(static_cast<int>(body.size()));
+        for (const auto& part : body) {
+            add(part.x);
+            add(part.y);
+        }
+    };
+    addBody(game.sim.snake);
+    addBody(game.sim.enemy1);
+    addBody(game.sim.enemy2);
+    add(game.sim.food.x);
+    add(game.sim.food.y);
+    add(game.sim.dir);
+    add(game.sim.dir2);
+    add(game.sim.dir3);
+    add(game.sim.score);
+    add(game.sim.gameOver);
+    return hash;
+}
+
+// Each game after a game over gets the next seed, so a session is fixed by its first one
+void GameRunner::play(int level, unsigned int seed, int ticks, vector<double>& updateNs, vector<double>& renderNs) {
+    unsigned int lcg = seed;
+    start(level, seed);
+
+    double toNs = 1e9 / SDL_GetPerformanceFrequency();
+    for (int tick = 0; tick < ticks; ++tick) {
+        input(lcg);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        game.update();
+        Uint64 updated = SDL_GetPerformanceCounter();
+        game.render();
+        Uint64 rendered = SDL_GetPerformanceCounter();
+        updateNs.push_back((updated - start) * toNs);
+        renderNs.push_back((rendered - updated) * toNs);
+
+        if (game.sim.gameOver) {
+            game.reset(++seed);
+        }
+    }
+}
+
+void GameRunner::trace(int level, unsigned int seed, int ticks, vector<uint64_t>& states) {
+    unsigned int lcg = seed;
+    start(level, seed);
+    for (int tick = 0; tick < ticks; ++tick) {
+        input(lcg);
+        game.update();
+        states.push_back(stateHash());
+        if (game.sim.hash != game.sim.boardHash()) {
+            hashDrift++;
+        }
+        if (game.sim.gameOver) {
+            game.reset(++seed);
+        }
+    }
+}
+
+// Same seed and inputs must give the same state after every tick
+static int checkDeterminism(GameRunner& runner, unsigned int seed, int ticks) {
+    int failures = 0;
+    runner.hashDrift = 0;
+    for (int level = 1; level <= 3; ++level) {
+        vector<uint64_t> first, second;
+        runner.trace(level, seed + level, ticks, first);
+        runner.trace(level, seed + level, ticks, second);
+        auto diverged = mismatch(first.begin(), first.end(), second.begin());
+        if (diverged.first != first.end()) {
+            cout << "level" << level << " diverged at tick " << diverged.first - first.begin() << endl;
+            failures++;
+        } else {
+            cout << "level" << level << " identical over " << ticks << " ticks" << endl;
+        }
+    }
+    if (runner.hashDrift > 0) {
+        cout << "incremental hash wrong on " << runner.hashDrift << " ticks" << endl;
+        failures++;
+    }
+    cout << (failures ? "FAILED: " : "OK: ") << "seed " << seed << endl;
+    return failures ? 1 : 0;
+}
+
+static double percentile(vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    sort(values.begin(), values.end());
+    return values[static_cast<size_t>(p * (values.size() - 1) + 0.5)];
+}
+
+static void addMetrics(map<string, double>& metrics, const string& prefix, const vector<double>& values) {
+    metrics[prefix + ".p50_ns"] = percentile(values, 0.50);
+    metrics[prefix + ".p90_ns"] = percentile(values, 0.90);
+    metrics[prefix + ".p99_ns"] = percentile(values, 0.99);
+}
+
+static bool readBaseline(const string& path, map<string, double>& baseline) {
+    ifstream in(path.c_str());
+    if (!in) {
+        return false;
+    }
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        istringstream fields(line);
+        string name;
+        double value;
+        if (fields >> name >> value) {
+            baseline[name] = value;
+        }
+    }
+    return true;
+}
+
+static bool writeBaseline(const string& path, const map<string, double>& metrics) {
+    ofstream out(path.c_str());
+    if (!out) {
+        return false;
+    }
+    out << "# metric value_ns, written by regress --write-baseline\n";
+    for (const auto& metric : metrics) {
+        out << metric.first << " " << static_cast<long long>(metric.second) << "\n";
+    }
+    return true;
+}
+
+int main(int argc, char* args[]) {
+    string baselinePath = DEFAULT_BASELINE;
+    double tolerance = 0.25;
+    int ticks = 3000;
+    unsigned int seed = 12345;
+    bool record = false;
+    bool determinism = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = args[i];
+        if (arg == "--baseline" && i + 1 < argc) {
+            baselinePath = args[++i];
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            tolerance = atof(args[++i]);//fraction, 0.25 allows 25% slower
+        } else if (arg == "--ticks" && i + 1 < argc) {
+            ticks = atoi(args[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned int>(strtoul(args[++i], nullptr, 10));
+        } else if (arg == "--write-baseline") {
+            record = true;
+        } else if (arg == "--determinism") {
+            determinism = true;
+        }
+    }
+
+    GameOptions options;
+    options.headless = true;
+    SnakeGame game(options);
+    if (!game.init()) {
+        cout << "Failed to initialize!" << endl;
+        return -1;
+    }
+
+    GameRunner runner(game);
+    if (determinism) {
+        return checkDeterminism(runner, seed, ticks);
+    }
+
+    map<string, double> metrics;
+    for (int level = 1; level <= 3; ++level) {
+        vector<double> updateNs, renderNs;
+        updateNs.reserve(ticks);
+        renderNs.reserve(ticks);
+        runner.play(level, seed + level, ticks, updateNs, renderNs);
+
+        string prefix = "level" + to_string(level);
+        addMetrics(metrics, prefix + ".update", updateNs);
+        addMetrics(metrics, prefix + ".render", renderNs);
+    }
+
+    map<string, double> baseline;
+    if (!record && !readBaseline(baselinePath, baseline)) {
+        cout << "No baseline at " << baselinePath << ": recording this run as the baseline, nothing is compared."
+             << " Run again to check for regressions." << endl;
+        record = true;//a clean checkout starts from its own numbers, later runs compare with them
+    }
+    if (record) {
+        if (!writeBaseline(baselinePath, metrics)) {
+            cout << "Failed to write " << baselinePath << endl;
+            return -1;
+        }
+        cout << "Wrote baseline " << baselinePath << endl;
+        return 0;
+    }
+
+    int regressions = 0;
+    for (const auto& metric : metrics) {
+        auto expected = baseline.find(metric.first);
+        if (expected == baseline.end()) {
+            cout << metric.first << " " << static_cast<long long>(metric.second) << " ns (not in baseline)" << endl;
+            continue;
+        }
+        double limit = expected->second * (1.0 + tolerance);
+        bool slower = metric.second > limit;
+        cout << metric.first << " " << static_cast<long long>(metric.second) << " ns, baseline "
+             << static_cast<long long>(expected->second) << " ns" << (slower ? "  REGRESSION" : "") << endl;
+        if (slower) {
+            regressions++;
+        }
+    }
+
+    cout << (regressions ? "FAILED: " : "OK: ") << regressions << " regressions at "
+         << tolerance * 100 << "% tolerance" << endl;
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,394 @@
+#include "replay.h"
+#include "log.h"
+#include "varint.h"
+#include "simulation.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+// A keyframe record from just after its REPLAY_KEYFRAME code
+static bool readKeyframe(const vector<uint8_t>& data, size_t& pos, ReplayKeyframe& keyframe) {
+    uint64_t tick, length;
+    if (!getVarint(data.data(), data.size(), pos, tick) || !getVarint(data.data(), data.size(), pos, length)
+        || length > data.size() - pos) {
+        return false;
+    }
+    keyframe.tick = static_cast<uint32_t>(tick);
+    keyframe.state.assign(data.begin() + pos, data.begin() + pos + length);
+    pos += length;
+    return true;
+}
+
+// Keyframes through the index, reading only their records
+static bool readIndex(const vector<uint8_t>& data, vector<ReplayKeyframe>& keyframes) {
+    size_t size = data.size();
+    if (size < sizeof(ReplayHeader) + 8 || memcmp(data.data() + size - 4, "SNKI", 4) != 0) {
+        return false;
+    }
+    size_t pos = 0;
+    for (int i = 0; i < 4; ++i) {
+        pos |= static_cast<size_t>(data[size - 8 + i]) << (i * 8);
+    }
+    uint64_t count, tick, offset, code;
+    if (!getVarint(data.data(), size - 8, pos, count)) {
+        return false;
+    }
+    keyframes.clear();
+    for (uint64_t i = 0; i < count; ++i) {
+        if (!getVarint(data.data(), size - 8, pos, tick) || !getVarint(data.data(), size - 8, pos, offset)) {
+            return false;
+        }
+        size_t at = static_cast<size_t>(offset);
+        ReplayKeyframe keyframe;
+        if (offset >= size || !getVarint(data.data(), size, at, code) || code != REPLAY_KEYFRAME
+            || !readKeyframe(data, at, keyframe) || keyframe.tick != tick) {
+            return false;
+        }
+        keyframes.push_back(move(keyframe));
+    }
+    return true;
+}
+
+bool loadReplay(const char* path, Replay& replay) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        LOG_ERROR("Failed to open replay %s", path);
+        return false;
+    }
+    vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(file);
+
+    if (data.size() < sizeof(ReplayHeader)) {
+        LOG_ERROR("Replay %s is too short", path);
+        return false;
+    }
+    memcpy(&replay.header, data.data(), sizeof(ReplayHeader));
+    if (memcmp(replay.header.magic, "SNRP", 4) != 0 || replay.header.version < 1
+        || replay.header.version > REPLAY_VERSION) {
+        LOG_ERROR("%s is not a version 1-%d replay", path, REPLAY_VERSION);
+        return false;
+    }
+
+    replay.inputs.clear();
+    replay.keyframes.clear();
+    replay.hashes.clear();
+    replay.complete = false;
+    replay.ticks = 0;
+    replay.score = 0;
+    replay.died = false;
+
+    bool indexed = replay.header.version >= REPLAY_CHAIN_VERSION && readIndex(data, replay.keyframes);
+    size_t pos = sizeof(ReplayHeader);
+    uint64_t tick = 0;      // of the previous change, +1
+    uint64_t bias = replay.header.version >= REPLAY_BIASED_VERSION ? 1 : 0;
+    uint64_t value;
+    while (getVarint(data.data(), data.size(), pos, value)) {
+        if (value >= REPLAY_FIRST_INPUT) {
+            tick += (value >> 2) - bias;
+            replay.inputs.push_back({ static_cast<uint32_t>(tick - 1), static_cast<uint8_t>(value & 3) });
+            continue;
+        }
+        if (value == REPLAY_KEYFRAME) {
+            ReplayKeyframe keyframe;
+            if (!readKeyframe(data, pos, keyframe)) {
+                break;//cut short in the middle of it
+            }
+            if (!indexed && replay.header.version >= REPLAY_CHAIN_VERSION) {
+                replay.keyframes.push_back(move(keyframe));
+            }
+            continue;
+        }
+        if (value == REPLAY_HASH) {
+            uint64_t hashTick;
+            if (!getVarint(data.data(), data.size(), pos, hashTick) || data.size() - pos < 8) {
+                break;//cut short in the middle of it
+            }
+            ReplayHash hash = { static_cast<uint32_t>(hashTick), 0 };
+            for (int i = 0; i < 8; ++i) {
+                hash.hash |= static_cast<uint64_t>(data[pos++]) << (i * 8);
+            }
+            replay.hashes.push_back(hash);
+            continue;
+        }
+        if (value != REPLAY_END) {
+            LOG_ERROR("Replay %s has unknown record %d", path, static_cast<int>(value));
+            return false;
+        }
+        uint64_t ticks, score, died;
+        if (getVarint(data.data(), data.size(), pos, ticks) && getVarint(data.data(), data.size(), pos, score)
+            && getVarint(data.data(), data.size(), pos, died)) {
+            replay.complete = true;
+            replay.ticks = static_cast<uint32_t>(ticks);
+            replay.score = static_cast<int>(score);
+            replay.died = died != 0;
+        }
+        break;
+    }
+    if (!replay.complete) {
+        //A game cut short by a crash still replays up to its last input
+        replay.ticks = replay.inputs.empty() ? 0 : replay.inputs.back().tick + 1;
+    }
+    return true;
+}
+
+void encodeReplay(const Replay& replay, vector<uint8_t>& out) {
+    ReplayHeader header = replay.header;
+    header.version = REPLAY_VERSION;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&header);
+    size_t start = out.size();
+    out.insert(out.end(), bytes, bytes + sizeof(header));
+    vector<pair<uint32_t, uint64_t>> index;
+    size_t nextHash = 0, nextKeyframe = 0;
+    //Hash then keyframe of the state before a tick's input, then the input, as the game records them
+    auto checkpointsTo = [&](uint32_t tick) {
+        for (;;) {
+            bool hashNext = nextHash < replay.hashes.size() && replay.hashes[nextHash].tick <= tick;
+            bool keyframeNext = nextKeyframe < replay.keyframes.size() && replay.keyframes[nextKeyframe].tick <= tick;
+            if (hashNext && (!keyframeNext || replay.hashes[nextHash].tick <= replay.keyframes[nextKeyframe].tick)) {
+                const ReplayHash& hash = replay.hashes[nextHash++];
+                putVarint(out, REPLAY_HASH);
+                putVarint(out, hash.tick);
+                for (int i = 0; i < 8; ++i) {
+                    out.push_back(static_cast<uint8_t>(hash.hash >> (i * 8)));
+                }
+            } else if (keyframeNext) {
+                const ReplayKeyframe& keyframe = replay.keyframes[nextKeyframe++];
+                index.push_back(make_pair(keyframe.tick, out.size() - start));
+                putVarint(out, REPLAY_KEYFRAME);
+                putVarint(out, keyframe.tick);
+                putVarint(out, keyframe.state.size());
+                out.insert(out.end(), keyframe.state.begin(), keyframe.state.end());
+            } else {
+                return;
+            }
+        }
+    };
+    uint32_t last = 0;
+    for (const auto& input : replay.inputs) {
+        checkpointsTo(input.tick);
+        putVarint(out, (static_cast<uint64_t>(input.tick + 2 - last) << 2) | (input.dir & 3));
+        last = input.tick + 1;
+    }
+    checkpointsTo(UINT32_MAX);
+    if (replay.complete) {
+        putVarint(out, REPLAY_END);
+        putVarint(out, replay.ticks);
+        putVarint(out, replay.score > 0 ? replay.score : 0);
+        putVarint(out, replay.died ? 1 : 0);
+        if (!index.empty()) {
+            uint64_t indexOffset = out.size() - start;
+            putVarint(out, index.size());
+            for (const auto& entry : index) {
+                putVarint(out, entry.first);
+                putVarint(out, entry.second);
+            }
+            for (int i = 0; i < 4; ++i) {
+                out.push_back(static_cast<uint8_t>(indexOffset >> (i * 8)));
+            }
+            out.insert(out.end(), { 'S', 'N', 'K', 'I' });
+        }
+    }
+}
+
+void replayAdvance(const Replay& replay, Simulation& sim, uint32_t target, size_t& nextInput) {
+    while (!sim.gameOver && sim.tick < target) {
+        while (nextInput < replay.inputs.size() && replay.inputs[nextInput].tick <= sim.tick) {
+            sim.dir = static_cast<Direction>(replay.inputs[nextInput++].dir);
+        }
+        sim.step();
+    }
+}
+
+uint32_t replaySeek(const Replay& replay, Simulation& sim, uint32_t target, size_t& nextInput) {
+    auto keyframe = upper_bound(replay.keyframes.begin(), replay.keyframes.end(), target,
+                                [](uint32_t tick, const ReplayKeyframe& k) { return tick < k.tick; });
+    if (keyframe == replay.keyframes.begin()
+        || !sim.loadState((keyframe - 1)->state.data(), (keyframe - 1)->state.size())) {
+        sim.setLevel(replay.header.level);
+        sim.reset(replay.header.seed);
+    }
+    uint32_t from = sim.tick;
+
+    nextInput = lower_bound(replay.inputs.begin(), replay.inputs.end(), sim.tick,
+                            [](const ReplayInput& input, uint32_t tick) { return input.tick < tick; })
+                - replay.inputs.begin();
+    replayAdvance(replay, sim, target, nextInput);
+    return from;
+}
+
+ReplayWriter::ReplayWriter() : inGame(false), lastTick(0), fileBytes(0), running(false), closePending(false) {}
+
+ReplayWriter::~ReplayWriter() {
+    stop();
+}
+
+bool ReplayWriter::start() {
+    lock_guard<std::mutex> lock(mutex);
+    if (running) {
+        return true;
+    }
+    pending.reserve(REPLAY_BUFFER_BYTES);
+    index.reserve(1024);
+    running = true;
+    thread = std::thread(&ReplayWriter::write, this);
+    return true;
+}
+
+void ReplayWriter::stop() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    wake.notify_all();
+    thread.join();
+    inGame = false;
+}
+
+// Waits for the previous file to be closed, which the writer does within one flush
+// interval; called between games, never during one
+bool ReplayWriter::begin(const char* path, const ReplayHeader& header) {
+    unique_lock<std::mutex> lock(mutex);
+    if (!running) {
+        return false;
+    }
+    wake.wait(lock, [this] { return !closePending && openPath.empty(); });
+
+    openPath = path;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&header);
+    pending.insert(pending.end(), bytes, bytes + sizeof(header));
+    fileBytes = sizeof(header);
+    index.clear();
+    lastTick = 0;
+    inGame = true;
+    lock.unlock();
+    wake.notify_all();
+    return true;
+}
+
+void ReplayWriter::record(uint32_t tick, uint8_t dir) {
+    if (!inGame) {
+        return;
+    }
+    lock_guard<std::mutex> lock(mutex);
+    size_t before = pending.size();
+    putVarint(pending, (static_cast<uint64_t>(tick + 2 - lastTick) << 2) | (dir & 3));//+1, see replay.h
+    fileBytes += pending.size() - before;
+    lastTick = tick + 1;
+}
+
+void ReplayWriter::keyframe(uint32_t tick, const vector<uint8_t>& state) {
+    if (!inGame) {
+        return;
+    }
+    lock_guard<std::mutex> lock(mutex);
+    index.push_back(make_pair(tick, fileBytes));
+    size_t before = pending.size();
+    putVarint(pending, REPLAY_KEYFRAME);
+    putVarint(pending, tick);
+    putVarint(pending, state.size());
+    pending.insert(pending.end(), state.begin(), state.end());
+    fileBytes += pending.size() - before;
+}
+
+void ReplayWriter::hash(uint32_t tick, uint64_t value) {
+    if (!inGame) {
+        return;
+    }
+    lock_guard<std::mutex> lock(mutex);
+    size_t before = pending.size();
+    putVarint(pending, REPLAY_HASH);
+    putVarint(pending, tick);
+    for (int i = 0; i < 8; ++i) {
+        pending.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+    fileBytes += pending.size() - before;
+}
+
+void ReplayWriter::finish(uint32_t ticks, int score, bool died) {
+    if (!inGame) {
+        return;
+    }
+    {
+        lock_guard<std::mutex> lock(mutex);
+        size_t before = pending.size();
+        putVarint(pending, REPLAY_END);
+        putVarint(pending, ticks);
+        putVarint(pending, score > 0 ? score : 0);
+        putVarint(pending, died ? 1 : 0);
+        if (!index.empty()) {
+            uint64_t indexOffset = fileBytes + pending.size() - before;
+            putVarint(pending, index.size());
+            for (const auto& entry : index) {
+                putVarint(pending, entry.first);
+                putVarint(pending, entry.second);
+            }
+            for (int i = 0; i < 4; ++i) {
+                pending.push_back(static_cast<uint8_t>(indexOffset >> (i * 8)));
+            }
+            pending.insert(pending.end(), { 'S', 'N', 'K', 'I' });
+        }
+        closePending = true;
+        inGame = false;
+    }
+    wake.notify_all();
+}
+
+void ReplayWriter::write() {
+    FILE* file = nullptr;
+    vector<uint8_t> writing;
+    writing.reserve(REPLAY_BUFFER_BYTES);
+
+    unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        bool stopping = !running;
+        string path;
+        path.swap(openPath);
+        writing.swap(pending);//both keep their capacity, so the game loop never allocates
+        bool closing = closePending;
+        lock.unlock();
+
+        if (!path.empty()) {
+            if (file != nullptr) {
+                fclose(file);
+            }
+            file = fopen(path.c_str(), "wb");
+            if (file == nullptr) {
+                LOG_ERROR("Failed to create replay %s", path);
+            }
+        }
+        if (file != nullptr && !writing.empty()) {
+            fwrite(writing.data(), 1, writing.size(), file);
+            fflush(file);//a crash loses at most one flush interval
+        }
+        writing.clear();
+        if (closing && file != nullptr) {
+            fclose(file);
+            file = nullptr;
+        }
+
+        lock.lock();
+        if (closing) {
+            closePending = false;
+            wake.notify_all();
+        }
+        if (stopping) {
+            break;
+        }
+        wake.wait_for(lock, chrono::milliseconds(REPLAY_FLUSH_MS),
+                      [this] { return !running || closePending || !openPath.empty(); });
+    }
+    if (file != nullptr) {
+        fclose(file);
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Input recordings. A game is fixed by its seed, level and the ticks at which the
+// direction changed, so that is all a replay stores:
+//
+//   ReplayHeader, then a stream of LEB128 varints:
+//     v >= 4   direction change, ((ticks since the previous change + 1) << 2) | direction,
+//              where the first change counts from tick -1; a second change in the same
+//              tick (a key and F4 in one frame) is 1, never one of the codes below
+//     v == 0   end, followed by varints ticks played, score and died (0/1)
+//     v == 1   keyframe, followed by varints tick and length, then Simulation::saveState()
+//              of the state before that tick's input
+//     v == 2   state hash, followed by varint tick and Simulation::stateHash() of the state
+//              before that tick's input as 8 little-endian bytes
+//     3        reserved
+//
+// If there are keyframes, the end record is followed by an index so a viewer can seek
+// without reading the whole stream: varint count, then varint tick and file offset of
+// each keyframe record, then the index's own offset as 4 little-endian bytes and "SNKI".
+//
+// Ticks are update() calls since the game's reset(), and a change at tick t takes
+// effect in that tick's update(). Version 1 files are version 2 without keyframes, and
+// version 2 files are version 3 without hashes. Version 4 keyframes store the snake as a
+// BodyChain; older keyframes are skipped and seeking re-simulates from the start instead.
+// Before version 5 the tick count of a change was not biased by 1.
+
+const uint16_t REPLAY_VERSION = 5;
+const uint16_t REPLAY_CHAIN_VERSION = 4;
+const uint16_t REPLAY_BIASED_VERSION = 5;
+const int REPLAY_FLUSH_MS = 500;
+const size_t REPLAY_BUFFER_BYTES = 4096;   // reserved up front, a game rarely needs more
+
+enum ReplayCode { REPLAY_END = 0, REPLAY_KEYFRAME = 1, REPLAY_HASH = 2, REPLAY_FIRST_INPUT = 4 };
+
+#pragma pack(push, 1)
+struct ReplayHeader {
+    char magic[4];          // "SNRP"
+    uint16_t version;
+    uint8_t level;          // 1-3
+    uint8_t reserved;
+    uint16_t boardWidth;    // pixels
+    uint16_t boardHeight;
+    uint64_t seed;
+};
+#pragma pack(pop)
+
+struct ReplayInput {
+    uint32_t tick;
+    uint8_t dir;            // Direction
+};
+
+struct ReplayKeyframe {
+    uint32_t tick;
+    std::vector<uint8_t> state;
+};
+
+struct ReplayHash {
+    uint32_t tick;
+    uint64_t hash;
+};
+
+struct Replay {
+    ReplayHeader header;
+    std::vector<ReplayInput> inputs;
+    std::vector<ReplayKeyframe> keyframes;  // in tick order
+    std::vector<ReplayHash> hashes;         // in tick order
+    bool complete;          // has the end record; otherwise the game was cut short
+    uint32_t ticks;
+    int score;
+    bool died;
+};
+
+class Simulation;
+
+bool loadReplay(const char* path, Replay& replay);
+
+// The whole replay in the file format above, keyframes, hashes and index included, in
+// the order the game writes them. Appends to out.
+void encodeReplay(const Replay& replay, std::vector<uint8_t>& out);
+
+// Steps sim through the replay's inputs until it reaches the target tick or the game ends.
+// nextInput is the first input not yet applied.
+void replayAdvance(const Replay& replay, Simulation& sim, uint32_t target, size_t& nextInput);
+
+// Puts sim at the target tick from the last keyframe at or before it, or from the start,
+// so with keyframes every N ticks it never simulates more than N. Returns the tick it
+// started from.
+uint32_t replaySeek(const Replay& replay, Simulation& sim, uint32_t target, size_t& nextInput);
+
+// Records one game at a time. The game loop only appends a few bytes to a buffer; the
+// writer thread opens, appends to and closes the files.
+class ReplayWriter {
+public:
+    ReplayWriter();
+    ~ReplayWriter();
+    bool start();
+    void stop();
+
+    bool begin(const char* path, const ReplayHeader& header);
+    void record(uint32_t tick, uint8_t dir);
+    void keyframe(uint32_t tick, const std::vector<uint8_t>& state);
+    void hash(uint32_t tick, uint64_t value);
+    void finish(uint32_t ticks, int score, bool died);
+    bool recording() const { return inGame; }
+
+private:
+    void write();
+
+    bool inGame;
+    uint32_t lastTick;      // of the previous change, +1 so the first one counts from -1
+    uint64_t fileBytes;     // appended to the current file so far
+    std::vector<std::pair<uint32_t, uint64_t>> index;   // keyframe tick and offset
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool running;
+    std::vector<uint8_t> pending;
+    std::string openPath;   // non-empty until the writer thread has opened it
+    bool closePending;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "resources.h"
+#include "log.h"
+#include "scene.h"
+#include <SDL2/SDL_image.h>
+#include <cstring>
+
+using namespace std;
+
+ResourceCounter resourceCounters[RES_KIND_COUNT];
+
+const char* resourceKindName(ResourceKind kind) {
+    switch (kind) {
+        case RES_TEXTURE: return "textures";
+        case RES_SURFACE: return "surfaces";
+        case RES_FONT:    return "fonts";
+        case RES_MUSIC:   return "music";
+        default:          return "?";
+    }
+}
+
+// Called once everything should have been released, so anything still live is a leak
+void resourceReport() {
+    for (int i = 0; i < RES_KIND_COUNT; ++i) {
+        const ResourceCounter& c = resourceCounters[i];
+        const char* name = resourceKindName(static_cast<ResourceKind>(i));
+        if (c.live != 0) {
+            LOG_WARN("Resources: %s created %lld, peak %d (%lld KB), LEAKED %d (%lld KB)",
+                     name, c.created, c.peak, c.peakBytes / 1024, c.live, c.bytes / 1024);
+        } else {
+            LOG_INFO("Resources: %s created %lld, peak %d (%lld KB)", name, c.created, c.peak, c.peakBytes / 1024);
+        }
+    }
+}
+
+size_t resourceBytes(SDL_Texture* texture) {
+    Uint32 format = 0;
+    int w = 0, h = 0;
+    if (SDL_QueryTexture(texture, &format, NULL, &w, &h) != 0) {
+        return 0;
+    }
+    return static_cast<size_t>(w) * h * SDL_BYTESPERPIXEL(format);
+}
+
+size_t resourceBytes(SDL_Surface* surface) {
+    return static_cast<size_t>(surface->pitch) * surface->h;
+}
+
+Texture loadImageTexture(SDL_Renderer* renderer, const char* path) {
+    Surface surface(IMG_Load(path));
+    if (!surface) {
+        LOG_ERROR("Failed to load image: %s", IMG_GetError());
+        return Texture();
+    }
+    return Texture(SDL_CreateTextureFromSurface(renderer, surface.get()));
+}
+
+TextureCache::TextureCache() : renderer(nullptr), budget(0), frame(0), evicted(0) {}
+
+TextureCache::Entry* TextureCache::find(const char* path) {
+    for (auto& entry : entries) {
+        if (strcmp(entry.path.c_str(), path) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+SDL_Texture* TextureCache::get(const char* path) {
+    Entry* entry = find(path);
+    if (entry == nullptr) {
+        entries.push_back({ path, Texture(), 0, false });
+        entry = &entries.back();
+    }
+    entry->lastUsed = frame;
+
+    if (!entry->texture) {
+        entry->texture = loadImageTexture(renderer, path);
+        if (!entry->texture) {
+            return nullptr;
+        }
+        enforceBudget();
+    }
+    return entry->texture.get();
+}
+
+void TextureCache::pin(const char* path) {
+    Entry* entry = find(path);
+    if (entry != nullptr) {
+        entry->pinned = true;
+    }
+}
+
+void TextureCache::enforceBudget() {
+    while (budget > 0 && bytes() > budget) {
+        Entry* coldest = nullptr;
+        for (auto& entry : entries) {
+            if (entry.texture && !entry.pinned && entry.lastUsed < frame
+                && (coldest == nullptr || entry.lastUsed < coldest->lastUsed)) {
+                coldest = &entry;
+            }
+        }
+        if (coldest == nullptr) {
+            return;//everything left is in use this frame
+        }
+        coldest->texture.reset();
+        evicted++;
+    }
+}
+
+size_t TextureCache::bytes() const {
+    size_t total = 0;
+    for (const auto& entry : entries) {
+        total += entry.texture.bytes();
+    }
+    return total;
+}
+
+void TextureCache::clear() {
+    entries.clear();
+}
+
+SDL_Texture* TextCache::get(TTF_Font* font, const char* text, SDL_Color color, int* w, int* h) {
+    Uint32 key = (Uint32(color.r) << 24) | (Uint32(color.g) << 16) | (Uint32(color.b) << 8) | color.a;
+    for (auto& entry : entries) {
+        if (entry.color == key && strcmp(entry.text.c_str(), text) == 0) {
+            *w = entry.w;
+            *h = entry.h;
+            return entry.texture.get();
+        }
+    }
+
+    Surface surface(textSurface(font, text, color));
+    if (!surface) {
+        return nullptr;
+    }
+    entries.push_back({ text, key, Texture(SDL_CreateTextureFromSurface(renderer, surface.get())),
+                        surface.get()->w, surface.get()->h });
+    *w = entries.back().w;
+    *h = entries.back().h;
+    return entries.back().texture.get();
+}
@@ -0,0 +1,150 @@
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <SDL2/SDL_mixer.h>
+#include <string>
+#include <vector>
+
+enum ResourceKind { RES_TEXTURE, RES_SURFACE, RES_FONT, RES_MUSIC, RES_KIND_COUNT };
+
+// Live and lifetime totals for one kind of SDL handle
+struct ResourceCounter {
+    int live;
+    int peak;
+    long long bytes;
+    long long peakBytes;
+    long long created;
+};
+
+extern ResourceCounter resourceCounters[RES_KIND_COUNT];
+
+const char* resourceKindName(ResourceKind kind);
+void resourceReport();
+
+size_t resourceBytes(SDL_Texture* texture);
+size_t resourceBytes(SDL_Surface* surface);
+inline size_t resourceBytes(TTF_Font*) { return 0; }
+inline size_t resourceBytes(Mix_Music*) { return 0; }
+
+inline void resourceDestroy(SDL_Texture* texture) { SDL_DestroyTexture(texture); }
+inline void resourceDestroy(SDL_Surface* surface) { SDL_FreeSurface(surface); }
+inline void resourceDestroy(TTF_Font* font) { TTF_CloseFont(font); }
+inline void resourceDestroy(Mix_Music* music) { Mix_FreeMusic(music); }
+
+// Owns one SDL handle and keeps resourceCounters up to date. Move-only.
+template <typename T, ResourceKind Kind>
+class Resource {
+public:
+    Resource() : handle(nullptr), size(0) {}
+    explicit Resource(T* h) : handle(nullptr), size(0) { reset(h); }
+    ~Resource() { reset(); }
+
+    Resource(Resource&& other) : handle(other.handle), size(other.size) {
+        other.handle = nullptr;
+        other.size = 0;
+    }
+
+    Resource& operator=(Resource&& other) {
+        if (this != &other) {
+            reset();
+            handle = other.handle;
+            size = other.size;
+            other.handle = nullptr;
+            other.size = 0;
+        }
+        return *this;
+    }
+
+    Resource(const Resource&) = delete;
+    Resource& operator=(const Resource&) = delete;
+
+    void reset(T* h = nullptr) {
+        ResourceCounter& counter = resourceCounters[Kind];
+        if (handle != nullptr) {
+            resourceDestroy(handle);
+            counter.live--;
+            counter.bytes -= size;
+        }
+        handle = h;
+        size = 0;
+        if (handle != nullptr) {
+            size = resourceBytes(handle);
+            counter.created++;
+            counter.live++;
+            counter.bytes += size;
+            if (counter.live > counter.peak) counter.peak = counter.live;
+            if (counter.bytes > counter.peakBytes) counter.peakBytes = counter.bytes;
+        }
+    }
+
+    T* get() const { return handle; }
+    size_t bytes() const { return size; }
+    explicit operator bool() const { return handle != nullptr; }
+
+private:
+    T* handle;
+    size_t size;
+};
+
+typedef Resource<SDL_Texture, RES_TEXTURE> Texture;
+typedef Resource<SDL_Surface, RES_SURFACE> Surface;
+typedef Resource<TTF_Font, RES_FONT> Font;
+typedef Resource<Mix_Music, RES_MUSIC> Music;
+
+Texture loadImageTexture(SDL_Renderer* renderer, const char* path);
+
+// Image textures loaded by path. With a budget set, textures not used in the current
+// frame are evicted least-recently-used first and reloaded the next time they are asked for.
+class TextureCache {
+public:
+    TextureCache();
+    void setRenderer(SDL_Renderer* r) { renderer = r; }
+    void setBudget(size_t bytes) { budget = bytes; }
+    SDL_Texture* get(const char* path);
+    void pin(const char* path);
+    void nextFrame() { frame++; }
+    void clear();
+    size_t bytes() const;
+    int evictions() const { return evicted; }
+
+private:
+    struct Entry {
+        std::string path;
+        Texture texture;
+        Uint64 lastUsed;
+        bool pinned;
+    };
+
+    Entry* find(const char* path);
+    void enforceBudget();
+
+    SDL_Renderer* renderer;
+    std::vector<Entry> entries;
+    size_t budget;
+    Uint64 frame;
+    int evicted;
+};
+
+// Text rendered once and kept, for labels drawn every frame. Lookups don't allocate.
+class TextCache {
+public:
+    TextCache() : renderer(nullptr) {}
+    void setRenderer(SDL_Renderer* r) { renderer = r; }
+    SDL_Texture* get(TTF_Font* font, const char* text, SDL_Color color, int* w, int* h);
+    void clear() { entries.clear(); }
+
+private:
+    struct Entry {
+        std::string text;
+        Uint32 color;
+        Texture texture;
+        int w, h;
+    };
+
+    SDL_Renderer* renderer;
+    std::vector<Entry> entries;
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include "rewind.h"
+
+using namespace std;
+
+RewindHistory::RewindHistory() : head(0), count(0), snapshotHead(0), snapshotCount(0), segmentsPerTick(1) {}
+
+void RewindHistory::init(size_t ticks, int boardWidth, int boardHeight) {
+    deltas.assign(ticks, RewindDelta());
+    //The longest snake covers the board, plus the segments it starts with off it
+    size_t cells = static_cast<size_t>(boardWidth / CELL_SIZE) * (boardHeight / CELL_SIZE) + 2;
+    segmentsPerTick = (cells + REWIND_SNAPSHOT_INTERVAL - 1) / REWIND_SNAPSHOT_INTERVAL;
+    snapshots.resize(ticks > 0 ? ticks / REWIND_SNAPSHOT_INTERVAL + 2 : 0);
+    for (auto& snapshot : snapshots) {
+        snapshot.snake.reserve(cells);
+        snapshot.enemies[0].reserve(3);//as reset() makes them
+        snapshot.enemies[1].reserve(3);
+    }
+    clear();
+}
+
+void RewindHistory::clear() {
+    head = 0;
+    count = 0;
+    snapshotHead = 0;
+    snapshotCount = 0;
+}
+
+size_t RewindHistory::bytes() const {
+    size_t total = deltas.capacity() * sizeof(RewindDelta);
+    for (const auto& snapshot : snapshots) {
+        total += (snapshot.snake.capacity() + snapshot.enemies[0].capacity() + snapshot.enemies[1].capacity())
+                 * sizeof(Point);
+    }
+    return total;
+}
+
+void RewindHistory::record(const Simulation& sim) {
+    if (deltas.empty() || sim.gameOver) {
+        return;
+    }
+    if (sim.tick % REWIND_SNAPSHOT_INTERVAL == 0) {
+        takeSnapshot(sim);
+    }
+    fillSnapshot(sim);
+
+    RewindDelta& delta = deltas[head];
+    delta.tick = sim.tick;
+    delta.tail = sim.snake.back();
+    delta.food = sim.food;
+    delta.enemyHeads[0] = sim.enemy1.front();
+    delta.enemyHeads[1] = sim.enemy2.front();
+    delta.enemyTails[0] = sim.enemy1.back();
+    delta.enemyTails[1] = sim.enemy2.back();
+    delta.rngState = sim.rng.getState();
+    delta.score = sim.score;
+    delta.dir = static_cast<uint8_t>(sim.dir);
+    delta.dir2 = static_cast<uint8_t>(sim.dir2);
+    head = (head + 1) % deltas.size();
+    count = min(count + 1, deltas.size());
+}
+
+// Everything but the body, which fillSnapshot() copies over the ticks that follow
+void RewindHistory::takeSnapshot(const Simulation& sim) {
+    dropUnfinishedSnapshot();//only a body longer than the board, which tools can set up, outruns it
+    RewindSnapshot& snapshot = snapshots[snapshotHead];
+    snapshot.tick = sim.tick;
+    snapshot.rngState = sim.rng.getState();
+    snapshot.food = sim.food;
+    snapshot.score = sim.score;
+    snapshot.dirs[0] = static_cast<uint8_t>(sim.dir);
+    snapshot.dirs[1] = static_cast<uint8_t>(sim.dir2);
+    snapshot.dirs[2] = static_cast<uint8_t>(sim.dir3);
+    snapshot.snake.resize(sim.snake.size());
+    snapshot.enemies[0].assign(sim.enemy1.begin(), sim.enemy1.end());
+    snapshot.enemies[1].assign(sim.enemy2.begin(), sim.enemy2.end());
+    snapshot.copied = 0;
+    snapshotHead = (snapshotHead + 1) % snapshots.size();
+    snapshotCount = min(snapshotCount + 1, snapshots.size());
+}
+
+// Every tick since the snapshot added a head, so its segment i is now at i + ticks since.
+// Copying from the tail stays ahead of the one segment a tick can drop there, and an undo
+// puts back exactly what the step took, so that still holds after rewinding a little.
+void RewindHistory::fillSnapshot(const Simulation& sim) {
+    if (snapshotCount == 0) {
+        return;
+    }
+    RewindSnapshot& snapshot = snapshots[(snapshotHead + snapshots.size() - 1) % snapshots.size()];
+    size_t moved = sim.tick - snapshot.tick;
+    for (size_t n = 0; n < segmentsPerTick && snapshot.copied < snapshot.snake.size(); ++n) {
+        size_t i = snapshot.snake.size() - 1 - snapshot.copied;
+        if (sim.tick < snapshot.tick || i + moved >= sim.snake.size()) {
+            dropUnfinishedSnapshot();//the game moved on some other way
+            return;
+        }
+        snapshot.snake[i] = sim.snake[i + moved];
+        snapshot.copied++;
+    }
+}
+
+void RewindHistory::dropUnfinishedSnapshot() {
+    if (snapshotCount == 0) {
+        return;
+    }
+    size_t newest = (snapshotHead + snapshots.size() - 1) % snapshots.size();
+    if (snapshots[newest].copied < snapshots[newest].snake.size()) {
+        snapshotHead = newest;
+        snapshotCount--;
+    }
+}
+
+// Works out what the step did from the state it left: a death leaves the snake where it
+// was, eating changes the score, and the enemies only moved if their first head did.
+// The hash and occupancy are undone with the bodies, so a tick back costs what step()
+// did: a head and a tail at the ends of the ring, and nothing per segment or board cell.
+bool RewindHistory::undo(Simulation& sim) {
+    if (count == 0) {
+        return false;
+    }
+    size_t newest = (head + deltas.size() - 1) % deltas.size();
+    const RewindDelta& delta = deltas[newest];
+    if (delta.tick + 1 != sim.tick) {
+        clear();//the game moved on some other way, by a reset or a restore
+        return false;
+    }
+
+    if (sim.level3 && (sim.enemy1[0].x != delta.enemyHeads[0].x || sim.enemy1[0].y != delta.enemyHeads[0].y)) {
+        sim.unshiftEnemies(delta.enemyHeads, delta.enemyTails);
+    }
+    if (!sim.gameOver) {
+        sim.retractHead();
+        if (sim.score == delta.score) {
+            sim.restoreTail(delta.tail);
+        }
+    }
+    sim.restoreFood(delta.food);
+    sim.rng.setState(delta.rngState);
+    sim.score = delta.score;
+    sim.dir = static_cast<Direction>(delta.dir);
+    sim.dir2 = static_cast<Direction>(delta.dir2);
+    sim.gameOver = false;
+    sim.tick = delta.tick;
+
+    head = newest;
+    count--;
+    dropNewerSnapshots(sim.tick);
+    return true;
+}
+
+void RewindHistory::dropNewerSnapshots(uint32_t tick) {
+    while (snapshotCount > 0) {
+        size_t newest = (snapshotHead + snapshots.size() - 1) % snapshots.size();
+        if (snapshots[newest].tick <= tick) {
+            break;
+        }
+        snapshotHead = newest;
+        snapshotCount--;
+    }
+}
+
+static void restore(Simulation& sim, const RewindSnapshot& snapshot) {
+    sim.snake.assign(snapshot.snake);
+    sim.enemy1.assign(snapshot.enemies[0].begin(), snapshot.enemies[0].end());
+    sim.enemy2.assign(snapshot.enemies[1].begin(), snapshot.enemies[1].end());
+    sim.food = snapshot.food;
+    sim.rng.setState(snapshot.rngState);
+    sim.score = snapshot.score;
+    sim.dir = static_cast<Direction>(snapshot.dirs[0]);
+    sim.dir2 = static_cast<Direction>(snapshot.dirs[1]);
+    sim.dir3 = static_cast<Direction>(snapshot.dirs[2]);
+    sim.gameOver = false;
+    sim.tick = snapshot.tick;
+    sim.rebuild();
+}
+
+// Loads the oldest finished snapshot still at or after the target, so at most one
+// snapshot interval of deltas is undone
+uint32_t RewindHistory::rewindTo(Simulation& sim, uint32_t target) {
+    if (count == 0) {
+        return sim.tick;
+    }
+    uint32_t oldest = sim.tick - static_cast<uint32_t>(count);
+    target = max(target, oldest);
+    for (size_t i = snapshotCount; i > 0; --i) {
+        const RewindSnapshot& snapshot = snapshots[(snapshotHead + snapshots.size() - i) % snapshots.size()];
+        if (snapshot.tick >= target && snapshot.tick <= sim.tick) {
+            if (snapshot.copied == snapshot.snake.size()) {
+                uint32_t dropped = sim.tick - snapshot.tick;
+                restore(sim, snapshot);
+                head = (head + deltas.size() - dropped) % deltas.size();
+                count -= dropped;
+                dropNewerSnapshots(sim.tick);
+            }
+            break;
+        }
+    }
+    while (sim.tick > target && undo(sim)) {
+    }
+    return sim.tick;
+}
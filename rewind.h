@@ -0,0 +1,70 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The last few minutes of a game, so it can be played backwards. A step() only adds a
+// head, drops a tail (unless the snake ate), moves the food and shifts the two short
+// enemies, so each tick is kept as a fixed-size delta of what it overwrote, whatever the
+// snake's length. Full states every REWIND_SNAPSHOT_INTERVAL ticks let rewindTo() jump
+// back without undoing every tick in between; a snapshot's body is copied a few segments
+// a tick from the tail up, finishing before the next one starts, so no tick copies the
+// whole snake. Everything is allocated by init(); once full, the oldest ticks are
+// overwritten.
+
+const uint32_t REWIND_SNAPSHOT_INTERVAL = 256;
+
+struct RewindDelta {
+    uint32_t tick;          // before the step
+    Point tail;             // dropped unless the snake ate
+    Point food;
+    Point enemyHeads[2];
+    Point enemyTails[2];
+    uint64_t rngState;
+    int score;
+    uint8_t dir;
+    uint8_t dir2;
+};
+
+// Everything step() changes; the obstacle, level and seed stay as they were
+struct RewindSnapshot {
+    uint32_t tick;
+    uint64_t rngState;
+    Point food;
+    int score;
+    uint8_t dirs[3];
+    std::vector<Point> snake;       // sized when taken, filled from the tail by later ticks
+    std::vector<Point> enemies[2];
+    size_t copied;                  // segments of snake filled in so far
+};
+
+class RewindHistory {
+public:
+    RewindHistory();
+    void init(size_t ticks, int boardWidth, int boardHeight);
+    void clear();
+    void record(const Simulation& sim);     // just before sim.step()
+    bool undo(Simulation& sim);             // one tick back, false once the history runs out
+    uint32_t rewindTo(Simulation& sim, uint32_t target);   // as far as the history goes, returns the tick
+    size_t ticks() const { return count; }
+    size_t bytes() const;
+
+private:
+    void takeSnapshot(const Simulation& sim);
+    void fillSnapshot(const Simulation& sim);
+    void dropUnfinishedSnapshot();
+    void dropNewerSnapshots(uint32_t tick);
+
+    std::vector<RewindDelta> deltas;        // ring, newest at head - 1
+    size_t head;
+    size_t count;
+    std::vector<RewindSnapshot> snapshots;  // ring, newest at snapshotHead - 1
+    size_t snapshotHead;
+    size_t snapshotCount;
+    size_t segmentsPerTick;                 // enough to copy the longest snake in one interval
+};
+
+#endif
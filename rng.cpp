@@ -0,0 +1,18 @@
+#include "rng.h"
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+// splitmix64 finalizer, spreads the clock's low-entropy bits over the whole word
+static uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+uint64_t clockSeed() {
+    static atomic<uint64_t> calls(0);
+    uint64_t now = static_cast<uint64_t>(chrono::high_resolution_clock::now().time_since_epoch().count());
+    return mix(now + 0x9e3779b97f4a7c15ull * calls.fetch_add(1));
+}
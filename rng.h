@@ -0,0 +1,47 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+// PCG32 (O'Neill): 16 bytes of state, a multiply and a rotate per number. Each game owns
+// one, so the same seed always gives the same food positions regardless of what else in
+// the process draws random numbers.
+class Rng {
+public:
+    Rng() { seed(0); }
+    explicit Rng(uint64_t value) { seed(value); }
+
+    void seed(uint64_t value) {
+        state = 0;
+        increment = 0xda3e39cb94b95bdbull;
+        next();
+        state += value;
+        next();
+    }
+
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ull + increment;
+        uint32_t shifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+        uint32_t rotation = static_cast<uint32_t>(old >> 59);
+        return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+    }
+
+    // Uniform in [0, bound), a multiply-shift instead of a division
+    uint32_t below(uint32_t bound) {
+        return static_cast<uint32_t>((static_cast<uint64_t>(next()) * bound) >> 32);
+    }
+
+    // For keyframes and snapshots, the increment is the same for every generator
+    uint64_t getState() const { return state; }
+    void setState(uint64_t value) { state = value; }
+
+private:
+    uint64_t state;
+    uint64_t increment;
+};
+
+// A fresh seed from the clock, different for every call even within the same tick
+uint64_t clockSeed();
+
+#endif
@@ -0,0 +1,57 @@
+#include "scene.h"
+
+using namespace std;
+
+static int drawCell(SDL_Renderer* renderer, const Point& part, SDL_Color fill, SDL_Color border) {
+    SDL_Rect rect = { part.x, part.y, CELL_SIZE, CELL_SIZE };
+    SDL_SetRenderDrawColor(renderer, fill.r, fill.g, fill.b, fill.a);
+    SDL_RenderFillRect(renderer, &rect);
+    SDL_SetRenderDrawColor(renderer, border.r, border.g, border.b, border.a);
+    SDL_RenderDrawRect(renderer, &rect);
+    return 2;
+}
+
+int drawScene(SDL_Renderer* renderer, const Simulation& sim, SDL_Texture* field, SDL_Texture* food) {
+    int drawCalls = 0;
+    SDL_SetRenderDrawColor(renderer, 86, 191, 0, 255);
+    SDL_RenderClear(renderer);
+
+    SDL_RenderCopy(renderer, field, NULL, NULL);
+    drawCalls++;
+
+    //Render snake
+    SDL_Color black = { 0, 0, 0, 255 };
+    SDL_Color white = { 255, 255, 255, 255 };
+    SDL_Color brown = { 94, 48, 35, 255 };
+    for (const auto& part : sim.snake) {
+        drawCalls += drawCell(renderer, part, black, white);
+    }
+
+    //Render food
+    SDL_Rect foodRect = { sim.food.x, sim.food.y, CELL_SIZE, CELL_SIZE };
+    SDL_RenderCopy(renderer, food, nullptr, &foodRect);
+    drawCalls++;
+
+    if(sim.level2){
+        SDL_Color obstacle = { 137, 87, 55, 255 };
+        for (const auto& part : sim.obs) {
+            drawCalls += drawCell(renderer, part, obstacle, brown);
+        }
+    }
+
+    if(sim.level3){
+        SDL_Color red = { 250, 0, 50, 255 };
+        SDL_Color blue = { 0, 0, 230, 255 };
+        for (const auto& part : sim.enemy1) {
+            drawCalls += drawCell(renderer, part, red, brown);
+        }
+        for (const auto& part : sim.enemy2) {
+            drawCalls += drawCell(renderer, part, blue, brown);
+        }
+    }
+    return drawCalls;
+}
+
+SDL_Surface* textSurface(TTF_Font* font, const char* text, SDL_Color color) {
+    return TTF_RenderText_Solid(font, text, color);
+}
@@ -0,0 +1,22 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include "simulation.h"
+
+// The board as the game draws it: field, snake, food, obstacle and enemies, in board
+// pixels. SnakeGame::render() and the video exporter both use it, so a replay exported
+// to video looks exactly like it did on screen. Returns the number of draw calls.
+
+const char* const FIELD_IMAGE = "snakeGameField.jpeg";
+const char* const FOOD_IMAGE = "snakefood.jpeg";
+const char* const FONT_FILE = "NotoSans_ExtraCondensed-MediumItalic.ttf";
+const int FONT_SIZE = 28;
+
+int drawScene(SDL_Renderer* renderer, const Simulation& sim, SDL_Texture* field, SDL_Texture* food);
+
+// Text as the game draws it, for the same reason; the caller frees the surface
+SDL_Surface* textSurface(TTF_Font* font, const char* text, SDL_Color color);
+
+#endif
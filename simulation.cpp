@@ -0,0 +1,400 @@
+#include "simulation.h"
+#include "varint.h"
+#include "bodychain.h"
+#include <algorithm>
+
+using namespace std;
+
+// What a Zobrist key stands for. The enemies get one per segment, since their bodies
+// overlap right after a move and equal keys would cancel out.
+enum HashFeature { HASH_BODY, HASH_HEAD, HASH_FOOD, HASH_OBSTACLE, HASH_STATE, HASH_ENEMY1 = 8, HASH_ENEMY2 = 16 };
+
+// The key for a feature at a cell. Computed rather than looked up in a random table,
+// because the enemies wander well off the board and a table would need bounds for them.
+static uint64_t zobrist(uint64_t feature, int x, int y) {
+    uint64_t z = (feature << 48) ^ (static_cast<uint64_t>(static_cast<uint32_t>(x / CELL_SIZE) & 0xffffff) << 24)
+                 ^ (static_cast<uint32_t>(y / CELL_SIZE) & 0xffffff);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;//splitmix64's finalizer
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static uint64_t enemyHash(const vector<Point>& enemy, int feature) {
+    uint64_t hash = 0;
+    for (size_t i = 0; i < enemy.size() && i < 8; ++i) {
+        hash ^= zobrist(feature + i, enemy[i].x, enemy[i].y);
+    }
+    return hash;
+}
+
+Simulation::Simulation(int boardWidth, int boardHeight)
+    : boardWidth(boardWidth), boardHeight(boardHeight), level2(false), level3(false), dir(UP), dir2(DOWN),
+      dir3(RIGHT), food({ 0, 0 }), score(0), gameOver(false), seed(0), tick(0), hash(0),
+      occupancy(static_cast<size_t>(boardWidth / CELL_SIZE) * (boardHeight / CELL_SIZE), 0) {}
+
+// Rounds up to a power of two so an index wraps with a mask; the body is moved to the
+// start of the new ring
+void SnakeBody::reserve(size_t capacity) {
+    if (capacity <= cells.size()) {
+        return;
+    }
+    size_t size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+    vector<Point> grown(size);
+    for (size_t i = 0; i < count; ++i) {
+        grown[i] = (*this)[i];
+    }
+    cells.swap(grown);
+    first = 0;
+}
+
+void SnakeBody::assign(const vector<Point>& points) {
+    clear();
+    reserve(points.size());
+    for (const auto& cell : points) {
+        push_back(cell);
+    }
+}
+
+// Everything random in a game comes from rng, so the seed and the inputs decide every tick
+void Simulation::reset(uint64_t gameSeed) {
+    tick = 0;
+    seed = gameSeed;
+    rng.seed(seed);
+    snake.clear();
+    snake.reserve((boardWidth / CELL_SIZE) * (boardHeight / CELL_SIZE) + 2);//step() never reallocates
+    snake.push_back({ boardWidth/2, boardHeight  });
+    snake.push_back({ boardWidth / 2 - CELL_SIZE, boardHeight  });
+    snake.push_back({ boardWidth / 2 - 2 * CELL_SIZE, boardHeight });
+    dir = UP;
+    score = 0;
+    gameOver = false;
+
+    // Define the obstacle in the middle of the screen with length of 10 cells
+    obs.clear();
+    int startX = (boardWidth / 2) - (CELL_SIZE * 5);
+    int startY = (boardHeight / 2)   - CELL_SIZE;
+    for (int i = 0; i < 10; ++i) {
+        obs.push_back({ startX + i * CELL_SIZE, startY });
+    }
+
+    //Define the enemies in the border of the screen;
+    
+    enemy1.clear();
+    enemy1.push_back({ boardWidth/2, 0  });
+    enemy1.push_back({ boardWidth / 2 - CELL_SIZE, boardHeight });
+    enemy1.push_back({ boardWidth / 2 - 2 * CELL_SIZE, boardHeight  });
+    dir2 = DOWN;
+
+    enemy2.clear();
+    enemy2.push_back({ 0-CELL_SIZE, boardHeight/2 });
+    enemy2.push_back({ boardWidth / 2 - CELL_SIZE, boardHeight });
+    enemy2.push_back({ boardWidth / 2 - 2 * CELL_SIZE, boardHeight });
+    dir3 = RIGHT;
+
+    fillOccupancy();
+    spawnFood();//after the obstacle, or the first game could put food where later ones can't
+    hash = boardHash();
+}
+
+void Simulation::rebuild() {
+    fillOccupancy();
+    hash = boardHash();
+}
+
+// Cells off the board are never occupied; the snake and enemies start just outside it
+bool Simulation::occupied(const Point& cell, uint8_t what) const {
+    if (cell.x < 0 || cell.x >= boardWidth || cell.y < 0 || cell.y >= boardHeight) {
+        return false;
+    }
+    return (occupancy[(cell.y / CELL_SIZE) * (boardWidth / CELL_SIZE) + cell.x / CELL_SIZE] & what) != 0;
+}
+
+void Simulation::mark(const Point& cell, uint8_t what, bool on) {
+    if (cell.x < 0 || cell.x >= boardWidth || cell.y < 0 || cell.y >= boardHeight) {
+        return;
+    }
+    uint8_t& bits = occupancy[(cell.y / CELL_SIZE) * (boardWidth / CELL_SIZE) + cell.x / CELL_SIZE];
+    bits = on ? (bits | what) : (bits & ~what);
+}
+
+void Simulation::fillOccupancy() {
+    fill(occupancy.begin(), occupancy.end(), 0);
+    for (const auto& part : snake) {
+        mark(part, OCCUPIED_SNAKE, true);
+    }
+    for (const auto& part : obs) {
+        mark(part, OCCUPIED_OBSTACLE, true);
+    }
+}
+
+// Once the snake covers every cell food can go on, which only a bot gets near, the food
+// is put off the board for good instead of being looked for forever
+void Simulation::spawnFood() {
+    hash ^= zobrist(HASH_FOOD, food.x, food.y);
+    int misses = 0;
+    do {
+        if (++misses % FOOD_FULL_CHECK == 0 && !roomForFood()) {
+            food = { -CELL_SIZE, -CELL_SIZE };
+            break;
+        }
+        food.x = (rng.below((boardWidth  / CELL_SIZE) -2) + 1) * CELL_SIZE;
+        food.y = (rng.below((boardHeight / CELL_SIZE) - 2) + 1) * CELL_SIZE;
+    } while (occupied(food, OCCUPIED_SNAKE | OCCUPIED_OBSTACLE));
+    hash ^= zobrist(HASH_FOOD, food.x, food.y);
+}
+
+bool Simulation::roomForFood() const {
+    for (int y = CELL_SIZE; y < boardHeight - CELL_SIZE; y += CELL_SIZE) {
+        for (int x = CELL_SIZE; x < boardWidth - CELL_SIZE; x += CELL_SIZE) {
+            if (!occupied({ x, y }, OCCUPIED_SNAKE | OCCUPIED_OBSTACLE)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int Simulation::step() {
+    if (gameOver) {
+        return 0;
+    }
+    tick++;
+
+    //Move the snake
+    Point newHead = snake[0];
+    switch (dir) {
+        case UP:    newHead.y -= CELL_SIZE; break;
+        case DOWN:  newHead.y += CELL_SIZE; break;
+        case LEFT:  newHead.x -= CELL_SIZE; break;
+        case RIGHT: newHead.x += CELL_SIZE; break;
+    }
+
+    //Check for collisions
+    if (checkCollision(newHead)) {
+        gameOver = true;
+        return STEP_DIED;
+    }
+
+    if(level3){
+        hash ^= enemyHash(enemy1, HASH_ENEMY1) ^ enemyHash(enemy2, HASH_ENEMY2);
+
+        moveEnemyHeads(enemy1[0], enemy2[0], dir2);
+
+        // Move the body segments of enemy1 to follow the head
+        for (int i = enemy1.size() - 1; i > 0; --i) {
+            enemy1[i] = enemy1[i - 1];  // Each segment follows the previous one
+        }
+
+        // Move the body segments of enemy2 to follow the head
+        for (int i = enemy2.size() - 1; i > 0; --i) {
+            enemy2[i] = enemy2[i - 1];  // Each segment follows the previous one
+        }
+        hash ^= enemyHash(enemy1, HASH_ENEMY1) ^ enemyHash(enemy2, HASH_ENEMY2);
+
+
+    }
+
+    if(level3){
+        if (occupied(enemy1[0], OCCUPIED_SNAKE) || occupied(enemy2[0], OCCUPIED_SNAKE)) {
+            gameOver = true;
+            return STEP_DIED;
+        }
+    }
+
+    hash ^= zobrist(HASH_HEAD, snake[0].x, snake[0].y) ^ zobrist(HASH_HEAD, newHead.x, newHead.y)
+            ^ zobrist(HASH_BODY, newHead.x, newHead.y);
+    snake.push_front(newHead);
+    mark(newHead, OCCUPIED_SNAKE, true);
+
+    if (newHead.x == food.x && newHead.y == food.y) {
+        score += 10;
+        spawnFood();
+        return STEP_ATE;
+    }
+    hash ^= zobrist(HASH_BODY, snake.back().x, snake.back().y);
+    mark(snake.back(), OCCUPIED_SNAKE, false);
+    snake.pop_back();
+    return 0;
+}
+
+// Only the heads matter: they are what kills the snake, and the bodies just follow them
+void Simulation::moveEnemyHeads(Point& head1, Point& head2, Direction& heading) const {
+    if (heading == DOWN) {
+        head1.y += CELL_SIZE;  // Move head down
+        if (head1.y >= boardHeight) {
+            head2.x += CELL_SIZE;   //Move head right
+            if (head2.x >= boardWidth) {
+                heading = UP;
+            }
+        }
+    } else {
+        head1.y -= CELL_SIZE;  // Move head up
+        if (head1.y < 0) {
+            head2.x -= CELL_SIZE;  // Move head left
+            if (head2.x < 0) {
+                heading = DOWN;
+            }
+        }
+    }
+}
+
+void Simulation::retractHead() {
+    hash ^= zobrist(HASH_HEAD, snake[0].x, snake[0].y) ^ zobrist(HASH_BODY, snake[0].x, snake[0].y)
+            ^ zobrist(HASH_HEAD, snake[1].x, snake[1].y);
+    mark(snake[0], OCCUPIED_SNAKE, false);
+    snake.pop_front();
+}
+
+void Simulation::restoreTail(const Point& tail) {
+    hash ^= zobrist(HASH_BODY, tail.x, tail.y);
+    mark(tail, OCCUPIED_SNAKE, true);
+    snake.push_back(tail);
+}
+
+void Simulation::restoreFood(const Point& cell) {
+    hash ^= zobrist(HASH_FOOD, food.x, food.y) ^ zobrist(HASH_FOOD, cell.x, cell.y);
+    food = cell;
+}
+
+static void unshift(vector<Point>& enemy, const Point& head, const Point& tail) {
+    for (size_t i = 1; i + 1 < enemy.size(); ++i) {
+        enemy[i] = enemy[i + 1];
+    }
+    enemy.front() = head;
+    enemy.back() = tail;
+}
+
+void Simulation::unshiftEnemies(const Point heads[2], const Point tails[2]) {
+    hash ^= enemyHash(enemy1, HASH_ENEMY1) ^ enemyHash(enemy2, HASH_ENEMY2);
+    unshift(enemy1, heads[0], tails[0]);
+    unshift(enemy2, heads[1], tails[1]);
+    hash ^= enemyHash(enemy1, HASH_ENEMY1) ^ enemyHash(enemy2, HASH_ENEMY2);
+}
+
+uint64_t Simulation::boardHash() const {
+    uint64_t board = zobrist(HASH_FOOD, food.x, food.y);
+    for (const auto& part : snake) {
+        board ^= zobrist(HASH_BODY, part.x, part.y);
+    }
+    if (!snake.empty()) {
+        board ^= zobrist(HASH_HEAD, snake[0].x, snake[0].y);
+    }
+    for (const auto& part : obs) {
+        board ^= zobrist(HASH_OBSTACLE, part.x, part.y);
+    }
+    return board ^ enemyHash(enemy1, HASH_ENEMY1) ^ enemyHash(enemy2, HASH_ENEMY2);
+}
+
+// The directions, level, score and game over change outside step() or every tick anyway
+uint64_t Simulation::stateHash() const {
+    int flags = dir | (dir2 << 2) | (dir3 << 4) | (level() << 6) | ((gameOver ? 1 : 0) << 8);
+    return hash ^ zobrist(HASH_STATE, flags * CELL_SIZE, score * CELL_SIZE);
+}
+
+// Walls, the snake's own body and (on level 2 and up) the obstacle
+bool Simulation::checkCollision(const Point& head) const {
+    if (head.x < 0 || head.x >= boardWidth || head.y < 0 || head.y >= boardHeight) {
+        return true;
+    }
+    return occupied(head, level2 ? OCCUPIED_SNAKE | OCCUPIED_OBSTACLE : OCCUPIED_SNAKE);
+}
+
+enum StateBodyFormat { STATE_BODY_POINTS = 0, STATE_BODY_CHAIN = 1 };
+
+template <typename Points>
+static void putPoints(vector<uint8_t>& out, const Points& points) {
+    putVarint(out, points.size());
+    for (const auto& part : points) {
+        putVarint(out, zigzag(part.x));//the snake and enemies start just off the board
+        putVarint(out, zigzag(part.y));
+    }
+}
+
+static bool getPoints(const uint8_t* data, size_t size, size_t& pos, vector<Point>& points, size_t limit) {
+    uint64_t count, x, y;
+    if (!getVarint(data, size, pos, count) || count > limit) {
+        return false;
+    }
+    points.clear();
+    for (uint64_t i = 0; i < count; ++i) {
+        if (!getVarint(data, size, pos, x) || !getVarint(data, size, pos, y)) {
+            return false;
+        }
+        points.push_back({ static_cast<int>(unzigzag(x)), static_cast<int>(unzigzag(y)) });
+    }
+    return true;
+}
+
+// Everything step() reads, as varints, with the snake as a BodyChain: a quarter byte per
+// segment. A body that isn't a chain of neighbouring cells, which only tools can make,
+// falls back to a list of points.
+void Simulation::saveState(vector<uint8_t>& out) const {
+    putVarint(out, tick);
+    putVarint(out, seed);
+    putVarint(out, rng.getState());
+    putVarint(out, level());
+    putVarint(out, dir | (dir2 << 2) | (dir3 << 4));
+    putVarint(out, score);
+    putVarint(out, gameOver ? 1 : 0);
+    putVarint(out, zigzag(food.x));
+    putVarint(out, zigzag(food.y));
+    size_t format = out.size();
+    putVarint(out, STATE_BODY_CHAIN);
+    if (!BodyChain::encode(snake, out)) {
+        out[format] = STATE_BODY_POINTS;
+        putPoints(out, snake);
+    }
+    putPoints(out, obs);
+    putPoints(out, enemy1);
+    putPoints(out, enemy2);
+}
+
+bool Simulation::loadState(const uint8_t* data, size_t size) {
+    size_t pos = 0;
+    uint64_t values[9];
+    for (auto& value : values) {
+        if (!getVarint(data, size, pos, value)) {
+            return false;
+        }
+    }
+    size_t cells = static_cast<size_t>(boardWidth / CELL_SIZE) * (boardHeight / CELL_SIZE) + 2;
+    vector<Point> bodies[4];
+    uint64_t format;
+    if (!getVarint(data, size, pos, format)) {
+        return false;
+    }
+    bool chained = format == STATE_BODY_CHAIN;
+    if (!(chained ? BodyChain::decode(data, size, pos, bodies[0], cells) : getPoints(data, size, pos, bodies[0], cells))) {
+        return false;
+    }
+    for (int i = 1; i < 4; ++i) {
+        if (!getPoints(data, size, pos, bodies[i], cells)) {
+            return false;
+        }
+    }
+    if (values[3] < 1 || values[3] > 3 || bodies[0].empty() || bodies[2].empty() || bodies[3].empty()) {
+        return false;
+    }
+
+    //assign() keeps the capacity reserved by reset()
+    snake.assign(bodies[0]);
+    obs.assign(bodies[1].begin(), bodies[1].end());
+    enemy1.assign(bodies[2].begin(), bodies[2].end());
+    enemy2.assign(bodies[3].begin(), bodies[3].end());
+    tick = static_cast<uint32_t>(values[0]);
+    seed = values[1];
+    rng.seed(seed);
+    rng.setState(values[2]);
+    setLevel(static_cast<int>(values[3]));
+    dir = static_cast<Direction>(values[4] & 3);
+    dir2 = static_cast<Direction>((values[4] >> 2) & 3);
+    dir3 = static_cast<Direction>((values[4] >> 4) & 3);
+    score = static_cast<int>(values[5]);
+    gameOver = values[6] != 0;
+    food = { static_cast<int>(unzigzag(values[7])), static_cast<int>(unzigzag(values[8])) };
+    rebuild();
+    return true;
+}
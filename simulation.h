@@ -0,0 +1,147 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "rng.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The game rules with no SDL in them: one step() is one tick. SnakeGame drives a
+// Simulation from the keyboard and draws it; tools re-simulate replays with it directly.
+// Positions are in pixels, multiples of CELL_SIZE, as everywhere else in the game.
+
+const int CELL_SIZE = 20;
+const int FOOD_FULL_CHECK = 4096;   // food placement misses between checks for a full board
+
+enum Direction { UP, DOWN, LEFT, RIGHT };
+
+struct Point {
+    int x, y;
+};
+
+// What happened in a step, for sounds, metrics and recordings
+enum StepEvent {
+    STEP_ATE = 1 << 0,
+    STEP_DIED = 1 << 1,
+};
+
+// The snake, head first, as a ring: step() adds a head and drops a tail, and rewinding
+// does the reverse, in O(1) whatever the length. Reads like a vector; reserve() once and
+// nothing after it allocates until the body outgrows it.
+class SnakeBody {
+public:
+    class const_iterator {
+    public:
+        const_iterator(const SnakeBody* body, size_t at) : body(body), at(at) {}
+        const Point& operator*() const { return (*body)[at]; }
+        const_iterator& operator++() { ++at; return *this; }
+        bool operator==(const const_iterator& other) const { return at == other.at; }
+        bool operator!=(const const_iterator& other) const { return at != other.at; }
+
+    private:
+        const SnakeBody* body;
+        size_t at;
+    };
+
+    SnakeBody() : first(0), count(0) {}
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const Point& operator[](size_t i) const { return cells[(first + i) & (cells.size() - 1)]; }
+    Point& operator[](size_t i) { return cells[(first + i) & (cells.size() - 1)]; }
+    const Point& front() const { return (*this)[0]; }
+    const Point& back() const { return (*this)[count - 1]; }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+
+    void clear() { first = 0; count = 0; }
+    void reserve(size_t capacity);
+    void assign(const std::vector<Point>& points);
+    void push_front(const Point& cell) {
+        if (count == cells.size()) {
+            reserve(count + 1);
+        }
+        first = (first - 1) & (cells.size() - 1);
+        cells[first] = cell;
+        count++;
+    }
+    void push_back(const Point& cell) {
+        if (count == cells.size()) {
+            reserve(count + 1);
+        }
+        count++;
+        (*this)[count - 1] = cell;
+    }
+    void pop_front() { first = (first + 1) & (cells.size() - 1); count--; }
+    void pop_back() { count--; }
+
+private:
+    std::vector<Point> cells;       // a power of two of them
+    size_t first;
+    size_t count;
+};
+
+// What is on a board cell, so collisions and food placement are a lookup instead of a
+// walk along the snake
+enum Occupant {
+    OCCUPIED_SNAKE = 1 << 0,
+    OCCUPIED_OBSTACLE = 1 << 1,
+};
+
+class Simulation {
+public:
+    Simulation(int boardWidth, int boardHeight);
+    void reset(uint64_t seed);      // keeps the level
+    int step();                     // StepEvent bits
+    void spawnFood();
+    bool checkCollision(const Point& head) const;
+    void saveState(std::vector<uint8_t>& out) const;    // appends
+    bool loadState(const uint8_t* data, size_t size);   // false if malformed, leaves the board size
+    int level() const { return level3 ? 3 : level2 ? 2 : 1; }
+
+    // Zobrist hash of the position for desync checks and as a search key: the bodies and
+    // food are kept in hash by step() at O(1) a tick, the rest is mixed in here
+    uint64_t stateHash() const;
+    uint64_t boardHash() const;     // what hash should be, from scratch
+    void rebuild();                 // hash and occupancy, after changing the bodies or food directly
+    bool occupied(const Point& cell, uint8_t what) const;
+    void setLevel(int level) { level2 = level >= 2; level3 = level >= 3; }
+
+    // One level 3 tick of the enemies' heads, steered by dir2, for bots that look ahead
+    void moveEnemyHeads(Point& head1, Point& head2, Direction& heading) const;
+
+    // step() backwards a piece at a time for RewindHistory, keeping hash and occupancy as
+    // step() does: take the head off, put a dropped tail back, put food back, and shift the
+    // enemies back to the heads and tails they had
+    void retractHead();
+    void restoreTail(const Point& tail);
+    void restoreFood(const Point& cell);
+    void unshiftEnemies(const Point heads[2], const Point tails[2]);
+
+    int boardWidth;
+    int boardHeight;
+    bool level2;
+    bool level3;
+    Direction dir;
+    Direction dir2;
+    Direction dir3;
+    SnakeBody snake;
+    Point food;
+    std::vector<Point> obs;
+    std::vector<Point> enemy1;
+    std::vector<Point> enemy2;
+    int score;
+    bool gameOver;
+    uint64_t seed;
+    Rng rng;
+    uint32_t tick;                  // steps since reset()
+    uint64_t hash;                  // snake, food, obstacle and enemies
+
+private:
+    void fillOccupancy();
+    bool roomForFood() const;
+    void mark(const Point& cell, uint8_t what, bool on);
+
+    std::vector<uint8_t> occupancy; // Occupant bits per board cell, kept by step()
+};
+
+#endif
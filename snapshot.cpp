@@ -0,0 +1,109 @@
+#include "snapshot.h"
+#include "log.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+using namespace std;
+
+// Swaps the new file in with one call, so the old save exists until the new one replaces it
+static bool replaceFile(const char* from, const char* to) {
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+static uint32_t checksum(const uint8_t* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void saveSnapshot(const Simulation& sim, vector<uint8_t>& out) {
+    out.resize(sizeof(SnapshotHeader));
+    sim.saveState(out);
+
+    SnapshotHeader header;
+    memcpy(header.magic, "SNSS", 4);
+    header.version = SNAPSHOT_VERSION;
+    header.reserved = 0;
+    header.boardWidth = static_cast<uint16_t>(sim.boardWidth);
+    header.boardHeight = static_cast<uint16_t>(sim.boardHeight);
+    header.stateSize = static_cast<uint32_t>(out.size() - sizeof(header));
+    header.checksum = checksum(out.data() + sizeof(header), header.stateSize);
+    memcpy(out.data(), &header, sizeof(header));
+}
+
+bool loadSnapshot(const uint8_t* data, size_t size, Simulation& sim) {
+    SnapshotHeader header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, "SNSS", 4) != 0 || header.version != SNAPSHOT_VERSION) {
+        return false;
+    }
+    if (header.boardWidth != sim.boardWidth || header.boardHeight != sim.boardHeight) {
+        LOG_WARN("Snapshot is for a %dx%d board, not %dx%d", header.boardWidth, header.boardHeight,
+                 sim.boardWidth, sim.boardHeight);
+        return false;
+    }
+    const uint8_t* state = data + sizeof(header);
+    if (header.stateSize != size - sizeof(header) || header.checksum != checksum(state, header.stateSize)) {
+        return false;
+    }
+    return sim.loadState(state, header.stateSize);
+}
+
+// Written beside the old one and renamed over it, so a crash mid-save keeps the last good save
+bool writeSnapshot(const char* path, const Simulation& sim) {
+    vector<uint8_t> data;
+    saveSnapshot(sim, data);
+    string temporary = string(path) + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        LOG_ERROR("Failed to create snapshot %s", temporary);
+        return false;
+    }
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    written = fclose(file) == 0 && written;
+    if (!written) {
+        LOG_ERROR("Failed to write snapshot %s", temporary);
+        remove(temporary.c_str());
+        return false;
+    }
+    if (!replaceFile(temporary.c_str(), path)) {
+        LOG_ERROR("Failed to replace snapshot %s", path);
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readSnapshot(const char* path, Simulation& sim) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        LOG_WARN("No snapshot at %s", path);
+        return false;
+    }
+    vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(file);
+
+    if (!loadSnapshot(data.data(), data.size(), sim)) {
+        LOG_ERROR("%s is not a usable snapshot", path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,176 @@
+#include "sound.h"
+#include "log.h"
+#include <cmath>
+
+using namespace std;
+
+// Optional WAV files that replace the built-in tones when present
+static const char* SFX_FILES[SFX_COUNT] = { "sfx_eat.wav", "sfx_die.wav", "sfx_level.wav" };
+
+// Built-in tones: start and end pitch (Hz) and length (ms)
+struct Tone {
+    double startHz;
+    double endHz;
+    int lengthMs;
+};
+
+static const Tone SFX_TONES[SFX_COUNT] = {
+    { 880.0, 1320.0, 60 },    // eat: short rising blip
+    { 440.0, 110.0, 350 },    // die: falling sweep
+    { 523.0, 1046.0, 180 },   // level start: octave jump
+};
+
+SoundEffects::SoundEffects()
+    : loaded(false), bufferSize(DEFAULT_AUDIO_BUFFER), frequency(AUDIO_FREQUENCY),
+      callbacks(0), lastCallback(0), totalInterval(0), minInterval(0), maxInterval(0),
+      lateCallbacks(0) {
+    for (int i = 0; i < SFX_COUNT; ++i) {
+        chunks[i] = nullptr;
+        toneBuffers[i] = nullptr;
+    }
+}
+
+SoundEffects::~SoundEffects() {
+    close();
+}
+
+bool SoundEffects::load(int size) {
+    bufferSize = size;
+
+    int channels = 2;
+    Uint16 format = 0;
+    if (Mix_QuerySpec(&frequency, &format, &channels) == 0) {
+        LOG_ERROR("Audio device is not open! Mix_Error: %s", Mix_GetError());
+        return false;
+    }
+
+    Mix_AllocateChannels(SFX_CHANNELS);
+
+    for (int i = 0; i < SFX_COUNT; ++i) {
+        chunks[i] = Mix_LoadWAV(SFX_FILES[i]);
+        if (chunks[i] == nullptr && !synthesize(static_cast<SoundEffect>(i), frequency, channels)) {
+            return false;
+        }
+    }
+
+    Mix_SetPostMix(postMix, this);
+    loaded = true;
+    return true;
+}
+
+bool SoundEffects::synthesize(SoundEffect effect, int rate, int channels) {
+    const Tone& tone = SFX_TONES[effect];
+    int frames = rate * tone.lengthMs / 1000;
+    Uint32 bytes = frames * channels * sizeof(Sint16);
+
+    toneBuffers[effect] = static_cast<Uint8*>(SDL_malloc(bytes));
+    if (toneBuffers[effect] == nullptr) {
+        return false;
+    }
+
+    Sint16* samples = reinterpret_cast<Sint16*>(toneBuffers[effect]);
+    double phase = 0.0;
+    for (int i = 0; i < frames; ++i) {
+        double t = static_cast<double>(i) / frames;
+        double hz = tone.startHz + (tone.endHz - tone.startHz) * t;
+        phase += 2.0 * M_PI * hz / rate;
+
+        //Square wave with a short attack and linear release so it doesn't click
+        double envelope = min(1.0, i / (rate * 0.005)) * (1.0 - t);
+        Sint16 value = static_cast<Sint16>((sin(phase) >= 0 ? 1 : -1) * envelope * 6000);
+        for (int c = 0; c < channels; ++c) {
+            samples[i * channels + c] = value;
+        }
+    }
+
+    chunks[effect] = Mix_QuickLoad_RAW(toneBuffers[effect], bytes);
+    if (chunks[effect] == nullptr) {
+        LOG_ERROR("Failed to create sound effect! Mix_Error: %s", Mix_GetError());
+        return false;
+    }
+    return true;
+}
+
+void SoundEffects::play(SoundEffect effect) {
+    if (!loaded || chunks[effect] == nullptr) {
+        return;
+    }
+
+    if (Mix_PlayChannel(-1, chunks[effect], 0) == -1) {
+        //Every channel is busy, cut off the oldest effect instead of dropping this one
+        int oldest = Mix_GroupOldest(-1);
+        if (oldest != -1) {
+            Mix_HaltChannel(oldest);
+            Mix_PlayChannel(oldest, chunks[effect], 0);
+        }
+    }
+}
+
+void SoundEffects::close() {
+    if (!loaded) {
+        return;
+    }
+    loaded = false;
+
+    Mix_SetPostMix(nullptr, nullptr);
+    Mix_HaltChannel(-1);
+    printStats();
+
+    for (int i = 0; i < SFX_COUNT; ++i) {
+        if (chunks[i] != nullptr) {
+            Mix_FreeChunk(chunks[i]);
+            chunks[i] = nullptr;
+        }
+        if (toneBuffers[i] != nullptr) {
+            SDL_free(toneBuffers[i]);
+            toneBuffers[i] = nullptr;
+        }
+    }
+}
+
+// Runs on the audio thread once per mixed buffer
+void SDLCALL SoundEffects::postMix(void* udata, Uint8* /*stream*/, int /*len*/) {
+    SoundEffects* self = static_cast<SoundEffects*>(udata);
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint64 last = self->lastCallback.exchange(now);
+    Uint64 count = self->callbacks.fetch_add(1);
+    if (count == 0) {
+        return;
+    }
+
+    Uint64 interval = now - last;
+    self->totalInterval += interval;
+    if (count == 1 || interval < self->minInterval) {
+        self->minInterval = interval;
+    }
+    if (interval > self->maxInterval) {
+        self->maxInterval = interval;
+    }
+
+    Uint64 expected = SDL_GetPerformanceFrequency() * self->bufferSize / self->frequency;
+    if (interval * 2 > expected * 3) {
+        self->lateCallbacks++;
+    }
+}
+
+AudioStats SoundEffects::stats() const {
+    double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+    AudioStats s;
+    s.callbacks = callbacks;
+    s.expectedMs = 1000.0 * bufferSize / frequency;
+    s.avgIntervalMs = s.callbacks > 1 ? totalInterval * toMs / (s.callbacks - 1) : 0.0;
+    s.minIntervalMs = minInterval * toMs;
+    s.maxIntervalMs = maxInterval * toMs;
+    s.lateCallbacks = lateCallbacks;
+    return s;
+}
+
+void SoundEffects::printStats() const {
+    AudioStats s = stats();
+    if (s.callbacks < 2) {
+        return;
+    }
+    LOG_INFO("Audio: buffer %d samples (%g ms), %llu callbacks, interval avg %g ms min %g ms max %g ms, late %llu",
+             bufferSize, s.expectedMs, s.callbacks, s.avgIntervalMs, s.minIntervalMs, s.maxIntervalMs,
+             s.lateCallbacks);
+}
@@ -0,0 +1,56 @@
+#ifndef SOUND_H
+#define SOUND_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <atomic>
+
+const int AUDIO_FREQUENCY = 44100;
+const int DEFAULT_AUDIO_BUFFER = 512;   // ~11.6 ms at 44.1 kHz
+const int MIN_AUDIO_BUFFER = 256;       // sample frames, powers of two in between
+const int MAX_AUDIO_BUFFER = 8192;
+const int SFX_CHANNELS = 8;
+
+enum SoundEffect { SFX_EAT, SFX_DIE, SFX_LEVEL_START, SFX_COUNT };
+
+// Snapshot of the audio callback timing, used to tune buffer size against underruns.
+struct AudioStats {
+    Uint64 callbacks;
+    double expectedMs;      // buffer length in ms
+    double avgIntervalMs;
+    double minIntervalMs;
+    double maxIntervalMs;
+    Uint64 lateCallbacks;   // interval > 1.5x the buffer length, likely an underrun
+};
+
+// Short effects preloaded into memory and played on a fixed pool of mixer channels.
+// play() never allocates, so it is safe to call from update().
+class SoundEffects {
+public:
+    SoundEffects();
+    ~SoundEffects();
+    bool load(int bufferSize);
+    void play(SoundEffect effect);
+    void close();
+    AudioStats stats() const;
+    void printStats() const;
+
+private:
+    bool synthesize(SoundEffect effect, int frequency, int channels);
+    static void SDLCALL postMix(void* udata, Uint8* stream, int len);
+
+    Mix_Chunk* chunks[SFX_COUNT];
+    Uint8* toneBuffers[SFX_COUNT];
+    bool loaded;
+    int bufferSize;
+    int frequency;
+
+    std::atomic<Uint64> callbacks;
+    std::atomic<Uint64> lastCallback;
+    std::atomic<Uint64> totalInterval;
+    std::atomic<Uint64> minInterval;
+    std::atomic<Uint64> maxInterval;
+    std::atomic<Uint64> lateCallbacks;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LEB128 varints, 7 bits per byte with the high bit set on all but the last. Signed
+// values go through zigzag first so small negatives stay short.
+
+inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// False if the data ends first or the value does not fit 64 bits
+inline bool getVarint(const uint8_t* data, size_t size, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < size; shift += 7) {
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+#endif
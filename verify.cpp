@@ -0,0 +1,200 @@
+#include "simulation.h"
+#include "replay.h"
+#include "log.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+// Replay verifier for leaderboard submissions. Re-simulates each replay with the game
+// rules alone (no SDL, no rendering, no tick delay) on every core and checks that it
+// ends at the claimed tick with the claimed score, and with the recorded state hashes on
+// the way if it has any. Exits non-zero if any replay fails.
+//
+//   verify [--threads N] [--repeat N] [--verbose] replay_*.snr
+//   verify --self-check     writes and reads back replays with two inputs in one tick
+
+struct Verdict {
+    bool ok;
+    string reason;
+    uint64_t ticks;         // simulated, over all repeats
+};
+
+static bool resimulate(const Replay& replay, Simulation& sim, string& reason) {
+    sim.setLevel(replay.header.level);
+    sim.reset(replay.header.seed);
+
+    size_t next = 0;
+    for (const auto& hash : replay.hashes) {
+        replayAdvance(replay, sim, hash.tick, next);
+        if (sim.tick == hash.tick && sim.stateHash() != hash.hash) {
+            reason = "desync at tick " + to_string(hash.tick);
+            return false;
+        }
+    }
+    replayAdvance(replay, sim, replay.ticks, next);
+
+    if (sim.tick != replay.ticks) {
+        reason = "ended at tick " + to_string(sim.tick) + ", claimed " + to_string(replay.ticks);
+        return false;
+    }
+    if (next != replay.inputs.size()) {
+        reason = "input after the end of the game";
+        return false;
+    }
+    if (sim.gameOver != replay.died) {
+        reason = replay.died ? "claimed a death that did not happen" : "snake died before the claimed end";
+        return false;
+    }
+    if (sim.score != replay.score) {
+        reason = "score " + to_string(sim.score) + ", claimed " + to_string(replay.score);
+        return false;
+    }
+    return true;
+}
+
+static Verdict verify(const string& path, int repeat) {
+    Verdict verdict = { false, "", 0 };
+    Replay replay;
+    if (!loadReplay(path.c_str(), replay)) {
+        verdict.reason = "unreadable";
+        return verdict;
+    }
+    if (!replay.complete) {
+        verdict.reason = "no end record to check against";
+        return verdict;
+    }
+    if (replay.header.level < 1 || replay.header.level > 3 || replay.header.boardWidth < 4 * CELL_SIZE
+        || replay.header.boardHeight < 4 * CELL_SIZE || replay.header.boardWidth % CELL_SIZE != 0
+        || replay.header.boardHeight % CELL_SIZE != 0) {
+        verdict.reason = "bad header";
+        return verdict;
+    }
+
+    Simulation sim(replay.header.boardWidth, replay.header.boardHeight);
+    verdict.ok = true;
+    for (int i = 0; i < repeat && verdict.ok; ++i) {
+        verdict.ok = resimulate(replay, sim, verdict.reason);
+        verdict.ticks += sim.tick;
+    }
+    return verdict;
+}
+
+static bool sameInputs(const char* what, const Replay& replay, const vector<ReplayInput>& inputs) {
+    bool same = replay.complete && replay.inputs.size() == inputs.size();
+    for (size_t i = 0; same && i < inputs.size(); ++i) {
+        same = replay.inputs[i].tick == inputs[i].tick && replay.inputs[i].dir == inputs[i].dir;
+    }
+    cout << what << ": " << (same ? "OK" : "FAILED") << endl;
+    return same;
+}
+
+// Both writers, ReplayWriter and encodeReplay(), with inputs that share a tick, read back
+static int selfCheck() {
+    const char* path = "verify_self_check.snr";
+    const vector<ReplayInput> inputs = { { 0, RIGHT }, { 5, UP }, { 5, UP }, { 5, LEFT }, { 9, DOWN }, { 9, RIGHT } };
+    ReplayHeader header;
+    memcpy(header.magic, "SNRP", 4);
+    header.version = REPLAY_VERSION;
+    header.level = 1;
+    header.reserved = 0;
+    header.boardWidth = 32 * CELL_SIZE;
+    header.boardHeight = 24 * CELL_SIZE;
+    header.seed = 1;
+
+    ReplayWriter writer;
+    writer.start();
+    writer.begin(path, header);
+    for (const auto& input : inputs) {
+        writer.record(input.tick, input.dir);
+    }
+    writer.finish(12, 0, false);
+    writer.stop();
+    Replay written;
+    bool ok = loadReplay(path, written) && sameInputs("ReplayWriter", written, inputs);
+
+    Replay replay;
+    replay.header = header;
+    replay.inputs = inputs;
+    replay.complete = true;
+    replay.ticks = 12;
+    replay.score = 0;
+    replay.died = false;
+    vector<uint8_t> bytes;
+    encodeReplay(replay, bytes);
+    FILE* file = fopen(path, "wb");
+    Replay encoded;
+    ok = file != nullptr && fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size() && fclose(file) == 0
+         && loadReplay(path, encoded) && sameInputs("encodeReplay", encoded, inputs) && ok;
+    remove(path);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char* args[]) {
+    int threads = static_cast<int>(thread::hardware_concurrency());
+    int repeat = 1;
+    bool verbose = false;
+    vector<string> paths;
+    for (int i = 1; i < argc; ++i) {
+        string arg = args[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = atoi(args[++i]);
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = atoi(args[++i]);//for throughput measurements on a small set
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else if (arg == "--self-check") {
+            return selfCheck();
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        cout << "usage: verify [--threads N] [--repeat N] [--verbose] replay..." << endl;
+        return 2;
+    }
+    threads = max(1, min(threads, static_cast<int>(paths.size())));
+    repeat = max(1, repeat);
+
+    //Workers take the next replay off a shared counter, so long games don't hold up a thread's share
+    vector<Verdict> verdicts(paths.size());
+    atomic<size_t> nextPath(0);
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            for (size_t i = nextPath++; i < paths.size(); i = nextPath++) {
+                verdicts[i] = verify(paths[i], repeat);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    uint64_t ticks = 0;
+    int failed = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        ticks += verdicts[i].ticks;
+        if (!verdicts[i].ok) {
+            failed++;
+            cout << paths[i] << ": FAILED, " << verdicts[i].reason << endl;
+        } else if (verbose) {
+            cout << paths[i] << ": OK" << endl;
+        }
+    }
+
+    double replays = static_cast<double>(paths.size()) * repeat;
+    cout << paths.size() - failed << "/" << paths.size() << " replays verified on " << threads << " threads in "
+         << seconds << " s: " << ticks / seconds << " ticks/s, " << replays / seconds << " replays/s" << endl;
+    logFlush();
+    return failed ? 1 : 0;
+}
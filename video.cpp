@@ -0,0 +1,351 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <SDL2/SDL_image.h>
+#include "scene.h"
+#include "simulation.h"
+#include "replay.h"
+#include "log.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+// Replay to video for highlight reels. Re-simulates a replay and draws one frame per tick
+// with drawScene(), the same code the game renders with, on software renderers, one per
+// worker thread. Frame f is the board after f ticks. Output is a numbered PNG sequence or
+// a YUV4MPEG2 stream ("-" for stdout, e.g. piped into ffmpeg), at any size: the board is
+// scaled to fit and letterboxed if the aspect ratio differs.
+//
+//   video [--size WxH] [--threads N] [--tick-rate N] (--png prefix | --y4m file|-) replay.snr
+
+const int DEFAULT_TICK_RATE = 7;    // FPS in game.h
+const int Y4M_SLOTS_PER_THREAD = 4; // frames a worker can get ahead of the writer
+
+// Everything one worker draws with. The textures are made on the main thread, since
+// SDL_CreateTextureFromSurface() caches a blit map on the shared source surface.
+struct Canvas {
+    SDL_Surface* target;
+    SDL_Renderer* renderer;
+    SDL_Texture* field;
+    SDL_Texture* food;
+    SDL_Texture* scoreLabel;
+    SDL_Texture* pauseLabel;
+    SDL_Texture* digits[10];
+};
+
+struct Sources {
+    SDL_Surface* field;
+    SDL_Surface* food;
+    SDL_Surface* scoreLabel;
+    SDL_Surface* pauseLabel;
+    SDL_Surface* digits[10];
+};
+
+// Frames waiting for the Y4M writer, which must write them in order
+struct FrameQueue {
+    mutex lock;
+    condition_variable wake;
+    vector<vector<uint8_t>> slots;
+    vector<bool> ready;
+    uint32_t written = 0;
+};
+
+static SDL_Texture* makeTexture(SDL_Renderer* renderer, SDL_Surface* surface) {
+    return surface != nullptr ? SDL_CreateTextureFromSurface(renderer, surface) : nullptr;
+}
+
+static int drawLabel(SDL_Renderer* renderer, SDL_Texture* label, int x, int y) {
+    int w = 0, h = 0;
+    if (label != nullptr) {
+        SDL_QueryTexture(label, nullptr, nullptr, &w, &h);
+        SDL_Rect rect = { x, y, w, h };
+        SDL_RenderCopy(renderer, label, nullptr, &rect);
+    }
+    return w;
+}
+
+// As SnakeGame::render() without the overlays
+static void drawFrame(Canvas& canvas, const Simulation& sim) {
+    drawScene(canvas.renderer, sim, canvas.field, canvas.food);
+
+    char digits[16];
+    snprintf(digits, sizeof(digits), "%d", sim.score);
+    int x = 10 + drawLabel(canvas.renderer, canvas.scoreLabel, 10, 10);
+    for (const char* c = digits; *c != '\0'; ++c) {
+        x += drawLabel(canvas.renderer, canvas.digits[*c - '0'], x, 10);
+    }
+    drawLabel(canvas.renderer, canvas.pauseLabel, 550, 10);
+    SDL_RenderPresent(canvas.renderer);
+}
+
+// BT.601 full range, 4:2:0 with each chroma sample averaged over its 2x2 block
+static void toYuv420(const SDL_Surface* surface, vector<uint8_t>& out) {
+    int w = surface->w, h = surface->h;
+    out.resize(w * h + 2 * (w / 2) * (h / 2));
+    uint8_t* y = out.data();
+    uint8_t* u = y + w * h;
+    uint8_t* v = u + (w / 2) * (h / 2);
+    const uint8_t* pixels = static_cast<const uint8_t*>(surface->pixels);
+
+    for (int row = 0; row < h; ++row) {
+        const uint32_t* line = reinterpret_cast<const uint32_t*>(pixels + row * surface->pitch);
+        for (int col = 0; col < w; ++col) {
+            int r = (line[col] >> 16) & 0xff, g = (line[col] >> 8) & 0xff, b = line[col] & 0xff;
+            y[row * w + col] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b) >> 8);
+        }
+    }
+    for (int row = 0; row < h / 2; ++row) {
+        const uint32_t* top = reinterpret_cast<const uint32_t*>(pixels + 2 * row * surface->pitch);
+        const uint32_t* bottom = reinterpret_cast<const uint32_t*>(pixels + (2 * row + 1) * surface->pitch);
+        for (int col = 0; col < w / 2; ++col) {
+            uint32_t p[4] = { top[2 * col], top[2 * col + 1], bottom[2 * col], bottom[2 * col + 1] };
+            int r = 0, g = 0, b = 0;
+            for (uint32_t pixel : p) {
+                r += (pixel >> 16) & 0xff;
+                g += (pixel >> 8) & 0xff;
+                b += pixel & 0xff;
+            }
+            r /= 4, g /= 4, b /= 4;
+            u[row * (w / 2) + col] = static_cast<uint8_t>(((-43 * r - 85 * g + 128 * b) >> 8) + 128);
+            v[row * (w / 2) + col] = static_cast<uint8_t>(((128 * r - 107 * g - 21 * b) >> 8) + 128);
+        }
+    }
+}
+
+// Draws frames first, first + step, ... up to last. Each worker keeps its own
+// Simulation and steps it forward from one of its frames to the next.
+static void drawFrames(const Replay& replay, Canvas& canvas, uint32_t first, uint32_t step, uint32_t last,
+                       const string& pngPrefix, FrameQueue* queue) {
+    Simulation sim(replay.header.boardWidth, replay.header.boardHeight);
+    size_t nextInput = 0;
+    replaySeek(replay, sim, first, nextInput);
+    vector<uint8_t> yuv;
+    char path[512];
+
+    for (uint32_t frame = first; frame <= last; frame += step) {
+        replayAdvance(replay, sim, frame, nextInput);
+        drawFrame(canvas, sim);
+
+        if (queue == nullptr) {
+            snprintf(path, sizeof(path), "%s_%06u.png", pngPrefix.c_str(), frame);
+            if (IMG_SavePNG(canvas.target, path) != 0) {
+                LOG_ERROR("Failed to write %s: %s", path, IMG_GetError());
+            }
+            continue;
+        }
+        toYuv420(canvas.target, yuv);
+        unique_lock<mutex> lock(queue->lock);
+        size_t slots = queue->slots.size();
+        queue->wake.wait(lock, [&] { return frame < queue->written + slots; });
+        queue->slots[frame % slots].swap(yuv);
+        queue->ready[frame % slots] = true;
+        lock.unlock();
+        queue->wake.notify_all();
+    }
+}
+
+static bool loadSources(Sources& sources) {
+    memset(&sources, 0, sizeof(sources));
+    sources.field = IMG_Load(FIELD_IMAGE);
+    sources.food = IMG_Load(FOOD_IMAGE);
+    if (sources.field == nullptr || sources.food == nullptr) {
+        cout << "Failed to load " << FIELD_IMAGE << " or " << FOOD_IMAGE << ": " << IMG_GetError() << endl;
+        return false;
+    }
+    TTF_Font* font = TTF_OpenFont(FONT_FILE, FONT_SIZE);
+    if (font == nullptr) {
+        cout << "Failed to load " << FONT_FILE << ": " << TTF_GetError() << endl;
+        return false;
+    }
+    SDL_Color black = { 0, 0, 0, 255 };
+    sources.scoreLabel = textSurface(font, "Score: ", black);
+    sources.pauseLabel = textSurface(font, "Pause", black);
+    for (int i = 0; i < 10; ++i) {
+        char digit[2] = { static_cast<char>('0' + i), '\0' };
+        sources.digits[i] = textSurface(font, digit, black);
+    }
+    TTF_CloseFont(font);
+    return true;
+}
+
+static void freeSources(Sources& sources) {
+    SDL_FreeSurface(sources.field);
+    SDL_FreeSurface(sources.food);
+    SDL_FreeSurface(sources.scoreLabel);
+    SDL_FreeSurface(sources.pauseLabel);
+    for (auto* digit : sources.digits) {
+        SDL_FreeSurface(digit);
+    }
+}
+
+static bool makeCanvas(Canvas& canvas, const Sources& sources, int width, int height, const ReplayHeader& header) {
+    memset(&canvas, 0, sizeof(canvas));
+    canvas.target = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    canvas.renderer = canvas.target != nullptr ? SDL_CreateSoftwareRenderer(canvas.target) : nullptr;
+    if (canvas.renderer == nullptr) {
+        cout << "Failed to create a " << width << "x" << height << " renderer: " << SDL_GetError() << endl;
+        return false;
+    }
+    //Draw in board pixels like the game does and let SDL scale them to the output size
+    SDL_RenderSetLogicalSize(canvas.renderer, header.boardWidth, header.boardHeight);
+    canvas.field = makeTexture(canvas.renderer, sources.field);
+    canvas.food = makeTexture(canvas.renderer, sources.food);
+    canvas.scoreLabel = makeTexture(canvas.renderer, sources.scoreLabel);
+    canvas.pauseLabel = makeTexture(canvas.renderer, sources.pauseLabel);
+    for (int i = 0; i < 10; ++i) {
+        canvas.digits[i] = makeTexture(canvas.renderer, sources.digits[i]);
+    }
+    return canvas.field != nullptr && canvas.food != nullptr;
+}
+
+static void freeCanvas(Canvas& canvas) {
+    //Destroying the renderer destroys its textures
+    if (canvas.renderer != nullptr) {
+        SDL_DestroyRenderer(canvas.renderer);
+    }
+    SDL_FreeSurface(canvas.target);
+}
+
+int main(int argc, char* args[]) {
+    int width = 0, height = 0;
+    int threads = static_cast<int>(thread::hardware_concurrency());
+    int tickRate = DEFAULT_TICK_RATE;
+    string pngPrefix, y4mPath, replayPath;
+    for (int i = 1; i < argc; ++i) {
+        string arg = args[i];
+        if (arg == "--size" && i + 1 < argc) {
+            if (sscanf(args[++i], "%dx%d", &width, &height) != 2) {
+                width = height = 0;
+            }
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = atoi(args[++i]);
+        } else if (arg == "--tick-rate" && i + 1 < argc) {
+            tickRate = max(1, atoi(args[++i]));
+        } else if (arg == "--png" && i + 1 < argc) {
+            pngPrefix = args[++i];
+        } else if (arg == "--y4m" && i + 1 < argc) {
+            y4mPath = args[++i];
+        } else {
+            replayPath = arg;
+        }
+    }
+    if (replayPath.empty() || pngPrefix.empty() == y4mPath.empty()) {
+        cout << "usage: video [--size WxH] [--threads N] [--tick-rate N] (--png prefix | --y4m file|-) replay.snr"
+             << endl;
+        return 2;
+    }
+
+    Replay replay;
+    if (!loadReplay(replayPath.c_str(), replay)) {
+        return 1;
+    }
+    if (replay.header.boardWidth < 4 * CELL_SIZE || replay.header.boardHeight < 4 * CELL_SIZE) {
+        cout << replayPath << ": bad header" << endl;
+        return 1;
+    }
+    if (width <= 0 || height <= 0) {
+        width = replay.header.boardWidth;
+        height = replay.header.boardHeight;
+    }
+    if (!y4mPath.empty()) {
+        width &= ~1;//4:2:0 needs whole chroma blocks
+        height &= ~1;
+    }
+    threads = max(1, min(threads, static_cast<int>(replay.ticks) + 1));
+    uint32_t frames = replay.ticks + 1;
+
+    if (SDL_Init(0) < 0 || TTF_Init() == -1 || !(IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG) & IMG_INIT_JPG)) {
+        cout << "SDL could not initialize: " << SDL_GetError() << endl;
+        return 1;
+    }
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
+
+    Sources sources;
+    vector<Canvas> canvases(threads);
+    bool ready = loadSources(sources);
+    for (int t = 0; t < threads && ready; ++t) {
+        ready = makeCanvas(canvases[t], sources, width, height, replay.header);
+    }
+
+    FILE* y4m = nullptr;
+    if (ready && !y4mPath.empty()) {
+        y4m = y4mPath == "-" ? stdout : fopen(y4mPath.c_str(), "wb");
+        if (y4m == nullptr) {
+            cout << "Failed to create " << y4mPath << endl;
+            ready = false;
+        }
+    }
+    if (!ready) {
+        for (auto& canvas : canvases) {
+            freeCanvas(canvas);
+        }
+        freeSources(sources);
+        IMG_Quit();
+        TTF_Quit();
+        SDL_Quit();
+        return 1;
+    }
+
+    FrameQueue queue;
+    if (y4m != nullptr) {
+        queue.slots.resize(threads * Y4M_SLOTS_PER_THREAD);
+        queue.ready.assign(queue.slots.size(), false);
+        fprintf(y4m, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, tickRate);
+    }
+
+    //Frames are dealt round-robin, so every worker walks the whole game once whatever the split
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back(drawFrames, cref(replay), ref(canvases[t]), static_cast<uint32_t>(t),
+                             static_cast<uint32_t>(threads), replay.ticks, cref(pngPrefix),
+                             y4m != nullptr ? &queue : nullptr);
+    }
+
+    if (y4m != nullptr) {
+        vector<uint8_t> frame;
+        size_t slots = queue.slots.size();
+        for (uint32_t f = 0; f < frames; ++f) {
+            {
+                unique_lock<mutex> lock(queue.lock);
+                queue.wake.wait(lock, [&] { return queue.ready[f % slots]; });
+                frame.swap(queue.slots[f % slots]);
+                queue.ready[f % slots] = false;
+                queue.written++;
+            }
+            queue.wake.notify_all();
+            fputs("FRAME\n", y4m);
+            fwrite(frame.data(), 1, frame.size(), y4m);
+        }
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if (y4m != nullptr && y4m != stdout) {
+        fclose(y4m);
+    }
+    for (auto& canvas : canvases) {
+        freeCanvas(canvas);
+    }
+    freeSources(sources);
+    IMG_Quit();
+    TTF_Quit();
+    SDL_Quit();
+
+    //With the video on stdout the report goes to stderr
+    ostream& report = y4m == stdout ? cerr : cout;
+    report << frames << " frames at " << width << "x" << height << " on " << threads << " threads in " << seconds
+           << " s: " << frames / seconds << " frames/s, " << frames / seconds / tickRate << "x real time" << endl;
+    logFlush();
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include "watchdog.h"
+#include "log.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+using namespace std;
+
+static int64_t nowMs() {
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TickWatchdog::TickWatchdog()
+    : budgetUs(0), written(0), running(false), armed(false), lastBeatMs(0),
+      pendingReason(DUMP_OVERRUN), pendingTick(0), stallDumped(false), lastDumpMs(0), dumps(0) {
+    memset(records, 0, sizeof(records));
+    sessionStamp[0] = '\0';
+}
+
+TickWatchdog::~TickWatchdog() {
+    stop();
+}
+
+bool TickWatchdog::start(const char* filePrefix, uint32_t budget) {
+    if (running) {
+        return true;
+    }
+    prefix = filePrefix;
+    time_t now = time(nullptr);
+    strftime(sessionStamp, sizeof(sessionStamp), "%Y%m%d-%H%M%S", localtime(&now));
+    budgetUs = budget;
+    pendingTick = 0;
+    lastDumpMs = nowMs() - DUMP_COOLDOWN_MS;
+    running = true;
+    thread = std::thread(&TickWatchdog::watch, this);
+    return true;
+}
+
+void TickWatchdog::stop() {
+    {
+        lock_guard<mutex> lock(wakeMutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void TickWatchdog::endTick(const TickRecord& record) {
+    {
+        lock_guard<mutex> lock(recordsMutex);
+        records[written % FLIGHT_RECORDER_SIZE] = record;
+        written++;
+    }
+    lastBeatMs = nowMs();
+    armed = true;
+
+    if (record.totalUs > budgetUs) {
+        requestDump(DUMP_OVERRUN, record.tick);
+    }
+}
+
+void TickWatchdog::disarm() {
+    armed = false;
+}
+
+void TickWatchdog::requestDump(DumpReason reason, uint32_t tick) {
+    {
+        lock_guard<mutex> lock(wakeMutex);
+        if (pendingTick != 0) {
+            return;//one is already waiting to be written
+        }
+        pendingReason = reason;
+        pendingTick = tick + 1;
+    }
+    wake.notify_one();
+}
+
+void TickWatchdog::watch() {
+    int64_t stallMs = max<int64_t>(STALL_FACTOR * static_cast<int64_t>(budgetUs) / 1000, 100);
+    int64_t stalledBeat = -1;
+
+    unique_lock<mutex> lock(wakeMutex);
+    while (running) {
+        wake.wait_for(lock, chrono::milliseconds(stallMs / 2));
+        if (!running) {
+            break;
+        }
+
+        if (pendingTick != 0) {
+            DumpReason reason = pendingReason;
+            uint32_t tick = pendingTick - 1;
+            pendingTick = 0;
+            lock.unlock();
+            writeDump(reason, tick);
+            lock.lock();
+        }
+
+        int64_t beat = lastBeatMs;
+        if (armed && beat != stalledBeat && nowMs() - beat > stallMs) {
+            stalledBeat = beat;//one dump per stall
+            lock.unlock();
+            writeDump(DUMP_STALL, 0);
+            lock.lock();
+        }
+    }
+}
+
+void TickWatchdog::writeDump(DumpReason reason, uint32_t tick) {
+    int64_t now = nowMs();
+    if (now - lastDumpMs < DUMP_COOLDOWN_MS || dumps >= MAX_DUMPS) {
+        return;
+    }
+    lastDumpMs = now;
+
+    //Copy out under the lock so the game loop is held up for as little as possible
+    static TickRecord copy[FLIGHT_RECORDER_SIZE];
+    uint32_t count;
+    {
+        lock_guard<mutex> lock(recordsMutex);
+        count = written < FLIGHT_RECORDER_SIZE ? written : FLIGHT_RECORDER_SIZE;
+        for (uint32_t i = 0; i < count; ++i) {
+            copy[i] = records[(written - count + i) % FLIGHT_RECORDER_SIZE];
+        }
+        if (reason == DUMP_STALL && count > 0) {
+            tick = copy[count - 1].tick + 1;//the tick that never finished
+        }
+    }
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s_%s_%03d.bin", prefix.c_str(), sessionStamp, dumps++);
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        return;
+    }
+
+    FlightHeader header;
+    memcpy(header.magic, "SNFR", 4);
+    header.version = 1;
+    header.recordSize = sizeof(TickRecord);
+    header.count = count;
+    header.budgetUs = budgetUs;
+    header.reason = reason;
+    header.triggerTick = tick;
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(copy, sizeof(TickRecord), count, file);
+    fclose(file);
+
+    LOG_WARN("Watchdog: tick %u %s, wrote %s", tick, reason == DUMP_STALL ? "stalled" : "overran its budget", path);
+}
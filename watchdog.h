@@ -0,0 +1,92 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <cstdint>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Tick-budget watchdog with a flight recorder of the last FLIGHT_RECORDER_SIZE ticks.
+// When a tick overruns its budget, or no tick completes for STALL_FACTOR budgets, the
+// recorder is written by the watchdog thread (never the game loop) to
+// <prefix>_<session start, YYYYMMDD-HHMMSS>_NNN.bin, so a restart keeps the last session's:
+//
+//   FlightHeader, then `count` TickRecords oldest first, all little-endian as in memory.
+
+const int FLIGHT_RECORDER_SIZE = 512;
+const int STALL_FACTOR = 4;
+const int DUMP_COOLDOWN_MS = 5000;   // at most one dump per cooldown
+const int MAX_DUMPS = 100;
+
+enum TickEvent {
+    TICK_INPUT = 1 << 0,    // direction changed
+    TICK_ATE = 1 << 1,
+    TICK_DIED = 1 << 2,
+    TICK_PAUSED = 1 << 3,
+    TICK_OVERRUN = 1 << 4,
+};
+
+enum DumpReason { DUMP_OVERRUN = 1, DUMP_STALL = 2 };
+
+#pragma pack(push, 1)
+struct TickRecord {
+    uint32_t tick;
+    uint32_t eventsUs;
+    uint32_t updateUs;
+    uint32_t renderUs;
+    uint32_t totalUs;
+    uint16_t events;        // TickEvent bits
+    uint16_t snakeLength;
+    int32_t score;
+};
+
+struct FlightHeader {
+    char magic[4];          // "SNFR"
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t count;
+    uint32_t budgetUs;
+    uint32_t reason;        // DumpReason
+    uint32_t triggerTick;
+};
+#pragma pack(pop)
+
+class TickWatchdog {
+public:
+    TickWatchdog();
+    ~TickWatchdog();
+    bool start(const char* prefix, uint32_t budgetUs);
+    void stop();
+    bool active() const { return running; }
+
+    void endTick(const TickRecord& record);   // also arms stall detection
+    void disarm();                            // menus and pause screens are not stalls
+
+private:
+    void watch();
+    void requestDump(DumpReason reason, uint32_t tick);
+    void writeDump(DumpReason reason, uint32_t tick);
+
+    std::string prefix;
+    char sessionStamp[16];
+    uint32_t budgetUs;
+    TickRecord records[FLIGHT_RECORDER_SIZE];
+    uint32_t written;
+    std::mutex recordsMutex;
+
+    std::thread thread;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool running;
+    std::atomic<bool> armed;
+    std::atomic<int64_t> lastBeatMs;
+    DumpReason pendingReason;
+    uint32_t pendingTick;
+    bool stallDumped;
+    int64_t lastDumpMs;
+    int dumps;
+};
+
+#endif